@@ -0,0 +1,181 @@
+#include "decode.h"
+
+static const Color WHITE(255, 255, 255);
+
+// ============================================================================
+// ============================================================================
+
+unsigned char
+Tag(const int x, const int y, const int bits)
+{
+	unsigned long v;
+	v = (static_cast<unsigned long>(x) * 73856093UL) & 0xFFFFFFFFUL;
+	v ^= (static_cast<unsigned long>(y) * 19349663UL) & 0xFFFFFFFFUL;
+	v ^= v >> 13;
+	v = (v * 0x5BD1E995UL) & 0xFFFFFFFFUL;
+	v ^= v >> 15;
+	return static_cast<unsigned char>(1 + v % ((1UL << bits) - 1));
+}
+
+void
+UnCompress(
+		const Image<bool> &occupancy,
+		const Image<Color> &hash_data,
+		const Image<Offset> &offset,
+		Image<Color> &output)
+{
+	/* Fetch useful values */
+	int h, w, hh, hw, oh, ow;
+	w = occupancy.Width();
+	h = occupancy.Height();
+	hw = hash_data.Width();
+	hh = hash_data.Height();
+	ow = offset.Width();
+	oh = offset.Height();
+	/* Set output pixels */
+	output.Allocate(w, h);
+	output.SetAllPixels(WHITE);
+	for (int x = 0; x < w; ++x) {
+		for (int y = 0; y < h; ++y) {
+			if (occupancy.GetPixel(x, y)) {
+				Offset o = offset.GetPixel(x % ow, y % oh);
+				Color c = hash_data.GetPixel((x + o.dx) % hw, (y + o.dy) % hh);
+				output.SetPixel(x, y, c);
+			}
+		}
+	}
+}
+
+void
+UnCompress(
+		const CheckTable &checks,
+		const Image<Color> &hash_data,
+		const Image<Offset> &offset,
+		Image<Color> &output)
+{
+	/* Fetch useful values */
+	int h, w, hh, hw, oh, ow, hx, hy;
+	w = checks.width;
+	h = checks.height;
+	hw = hash_data.Width();
+	hh = hash_data.Height();
+	ow = offset.Width();
+	oh = offset.Height();
+	assert(checks.tags.Width() == hw && checks.tags.Height() == hh);
+	/* Set output pixels whose slot carries their tag */
+	output.Allocate(w, h);
+	output.SetAllPixels(WHITE);
+	for (int x = 0; x < w; ++x) {
+		for (int y = 0; y < h; ++y) {
+			Offset o = offset.GetPixel(x % ow, y % oh);
+			hx = (x + o.dx) % hw;
+			hy = (y + o.dy) % hh;
+			if (checks.tags.GetPixel(hx, hy) == Tag(x, y, checks.bits)) {
+				output.SetPixel(x, y, hash_data.GetPixel(hx, hy));
+			}
+		}
+	}
+}
+
+// ============================================================================
+// ============================================================================
+
+/* Bytes per pixel in each format */
+static int
+Depth(const PixelFormat format)
+{
+	return (format == RGB24) ? 3 : 4;
+}
+
+/* Store one pixel in the given format */
+static void
+Put(unsigned char *p, const PixelFormat format, const Color &c, const unsigned char a)
+{
+	switch (format) {
+	case RGB24:
+		p[0] = c.red; p[1] = c.green; p[2] = c.blue;
+		break;
+	case RGBA32:
+		p[0] = c.red; p[1] = c.green; p[2] = c.blue; p[3] = a;
+		break;
+	case BGRA32:
+		p[0] = c.blue; p[1] = c.green; p[2] = c.red; p[3] = a;
+		break;
+	}
+}
+
+void
+UnCompress(
+		const Image<bool> &occupancy,
+		const Image<Color> &hash_data,
+		const Image<Offset> &offset,
+		const Framebuffer &fb,
+		int x0, int y0, int width, int height)
+{
+	/* Fetch useful values */
+	int h, w, hh, hw, oh, ow, bpp, y;
+	w = occupancy.Width();
+	h = occupancy.Height();
+	hw = hash_data.Width();
+	hh = hash_data.Height();
+	ow = offset.Width();
+	oh = offset.Height();
+	bpp = Depth(fb.format);
+	if (width < 0) width = w - x0;
+	if (height < 0) height = h - y0;
+	assert(x0 >= 0 && x0 + width <= w);
+	assert(y0 >= 0 && y0 + height <= h);
+	/* Fill the rectangle a row at a time, top row first */
+	for (int r = 0; r < height; ++r) {
+		unsigned char *p = fb.pixels + r * fb.pitch;
+		y = y0 + height - 1 - r;
+		for (int x = x0; x < x0 + width; ++x, p += bpp) {
+			if (occupancy.GetPixel(x, y)) {
+				Offset o = offset.GetPixel(x % ow, y % oh);
+				Color c = hash_data.GetPixel((x + o.dx) % hw, (y + o.dy) % hh);
+				Put(p, fb.format, c, 255);
+			} else {
+				Put(p, fb.format, fb.background, fb.background_alpha);
+			}
+		}
+	}
+}
+
+void
+UnCompress(
+		const CheckTable &checks,
+		const Image<Color> &hash_data,
+		const Image<Offset> &offset,
+		const Framebuffer &fb,
+		int x0, int y0, int width, int height)
+{
+	/* Fetch useful values */
+	int h, w, hh, hw, oh, ow, hx, hy, bpp, y;
+	w = checks.width;
+	h = checks.height;
+	hw = hash_data.Width();
+	hh = hash_data.Height();
+	ow = offset.Width();
+	oh = offset.Height();
+	bpp = Depth(fb.format);
+	assert(checks.tags.Width() == hw && checks.tags.Height() == hh);
+	if (width < 0) width = w - x0;
+	if (height < 0) height = h - y0;
+	assert(x0 >= 0 && x0 + width <= w);
+	assert(y0 >= 0 && y0 + height <= h);
+	/* Fill the rectangle a row at a time, top row first */
+	for (int r = 0; r < height; ++r) {
+		unsigned char *p = fb.pixels + r * fb.pitch;
+		y = y0 + height - 1 - r;
+		for (int x = x0; x < x0 + width; ++x, p += bpp) {
+			Offset o = offset.GetPixel(x % ow, y % oh);
+			hx = (x + o.dx) % hw;
+			hy = (y + o.dy) % hh;
+			if (checks.tags.GetPixel(hx, hy) == Tag(x, y, checks.bits)) {
+				Put(p, fb.format, hash_data.GetPixel(hx, hy), 255);
+			} else {
+				Put(p, fb.format, fb.background, fb.background_alpha);
+			}
+		}
+	}
+}
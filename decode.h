@@ -0,0 +1,74 @@
+#ifndef _DECODE_H_
+#define _DECODE_H_
+
+#include "image.h"
+
+// ====================================================================
+// ====================================================================
+// DECODING
+//    rebuilds an image from its compressed representation, either into
+//    a new Image<Color> or into memory the caller already owns
+//
+
+// layout of one pixel in a Framebuffer
+enum PixelFormat {
+  RGB24,  // red, green, blue
+  RGBA32, // red, green, blue, alpha
+  BGRA32  // blue, green, red, alpha
+};
+
+// ====================================================================
+// caller-owned pixels, top row first (as in the .ppm files); these are
+// the pixels of the rectangle being decoded, not of the whole image
+struct Framebuffer {
+  explicit Framebuffer(
+      unsigned char *p = NULL,
+      int b = 0,
+      PixelFormat f = RGB24) :
+    pixels(p), pitch(b), format(f), background(), background_alpha(255) { }
+
+  // first byte of the top row of the decoded rectangle (its top left
+  // pixel), and bytes from one row to the next
+  unsigned char *pixels;
+  int pitch;
+  PixelFormat format;
+  // written wherever the image is blank (alpha only in 32 bit formats)
+  Color background;
+  unsigned char background_alpha;
+};
+
+// the tag a .check table keeps for pixel (x, y); never 0
+unsigned char Tag(int x, int y, int bits);
+
+// decode the whole image into a new Image<Color>
+void UnCompress(
+    const Image<bool> &occupancy,
+    const Image<Color> &hash_data,
+    const Image<Offset> &offset,
+    Image<Color> &output);
+void UnCompress(
+    const CheckTable &checks,
+    const Image<Color> &hash_data,
+    const Image<Offset> &offset,
+    Image<Color> &output);
+
+// decode the width x height rectangle whose bottom left corner is (x0, y0)
+// straight into fb (by default, the whole image); fb.pixels must point at
+// where the rectangle's top left pixel goes, so to draw into a buffer of
+// the whole image, point it at row (image height - y0 - height), column
+// x0 of that buffer; width pixels of each of height rows are written,
+// nothing else is touched
+void UnCompress(
+    const Image<bool> &occupancy,
+    const Image<Color> &hash_data,
+    const Image<Offset> &offset,
+    const Framebuffer &fb,
+    int x0 = 0, int y0 = 0, int width = -1, int height = -1);
+void UnCompress(
+    const CheckTable &checks,
+    const Image<Color> &hash_data,
+    const Image<Offset> &offset,
+    const Framebuffer &fb,
+    int x0 = 0, int y0 = 0, int width = -1, int height = -1);
+
+#endif
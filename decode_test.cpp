@@ -0,0 +1,115 @@
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "decode.h"
+#include "image.h"
+
+/* Checks that decoding into a Framebuffer gives the same pixels as decoding
+ * into an Image<Color>, for every pixel format, a rectangle away from the
+ * image's corner, padded rows, and a non-white background */
+
+static const Color WHITE(255, 255, 255);
+static const int PAD = 7;
+static const unsigned char GUARD = 0xA5;
+
+/* Bytes per pixel, and where each channel sits within a pixel */
+static int
+Layout(const PixelFormat format, int &r, int &g, int &b, int &a)
+{
+	switch (format) {
+	case RGB24:  r = 0; g = 1; b = 2; a = -1; return 3;
+	case RGBA32: r = 0; g = 1; b = 2; a = 3;  return 4;
+	case BGRA32: r = 2; g = 1; b = 0; a = 3;  return 4;
+	}
+	return 0;
+}
+
+/* Decode the rectangle at (x0, y0) and count the bytes that are wrong,
+ * including any padding the decode should have left alone */
+template <class MASK>
+static int
+Check(
+		const MASK &mask,
+		const Image<Color> &hash_data,
+		const Image<Offset> &offset,
+		const Image<Color> &expected,
+		const PixelFormat format,
+		const int x0, const int y0, const int width, const int height)
+{
+	int r = 0, g = 1, b = 2, a = -1, errors = 0;
+	int bpp = Layout(format, r, g, b, a);
+	int pitch = bpp * width + PAD;
+	std::vector<unsigned char> bytes(pitch * height, GUARD);
+	Framebuffer fb(&bytes[0], pitch, format);
+	fb.background = Color(10, 20, 30);
+	fb.background_alpha = 40;
+	UnCompress(mask, hash_data, offset, fb, x0, y0, width, height);
+	for (int row = 0; row < height; ++row) {
+		const unsigned char *p = &bytes[row * pitch];
+		int y = y0 + height - 1 - row;
+		for (int x = x0; x < x0 + width; ++x, p += bpp) {
+			Color c = expected.GetPixel(x, y);
+			bool blank = (c == WHITE);
+			if (blank) c = fb.background;
+			errors += (p[r] != c.red) + (p[g] != c.green) + (p[b] != c.blue);
+			if (a >= 0) errors += (p[a] != (blank ? fb.background_alpha : 255));
+		}
+		for (int i = 0; i < PAD; ++i) errors += (p[i] != GUARD);
+	}
+	return errors;
+}
+
+/* Try each format on the whole image and on a rectangle inside it */
+template <class MASK>
+static int
+CheckAll(
+		const MASK &mask,
+		const Image<Color> &hash_data,
+		const Image<Offset> &offset,
+		const Image<Color> &expected)
+{
+	const PixelFormat formats[] = { RGB24, RGBA32, BGRA32 };
+	int w = expected.Width(), h = expected.Height(), errors = 0;
+	for (int f = 0; f < 3; ++f) {
+		errors += Check(mask, hash_data, offset, expected, formats[f],
+				0, 0, w, h);
+		errors += Check(mask, hash_data, offset, expected, formats[f],
+				w / 4, h / 3, w / 2, h / 2);
+	}
+	return errors;
+}
+
+int
+main(int argc, char *argv[])
+{
+	if (argc != 4) {
+		std::cerr << "Usage: " << argv[0]
+			<< " {occupancy.pbm,checks.check} data.ppm offset.offset" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::string mask = argv[1];
+	bool checked = mask.length() > 6 && mask.substr(mask.length() - 6) == ".check";
+	Image<Color> hash_data, expected;
+	Image<Offset> offset;
+	if (!hash_data.Load(argv[2]) || !offset.Load(argv[3])) return EXIT_FAILURE;
+	int errors;
+	if (checked) {
+		CheckTable checks;
+		if (!checks.Load(mask)) return EXIT_FAILURE;
+		UnCompress(checks, hash_data, offset, expected);
+		errors = CheckAll(checks, hash_data, offset, expected);
+	} else {
+		Image<bool> occupancy;
+		if (!occupancy.Load(mask)) return EXIT_FAILURE;
+		UnCompress(occupancy, hash_data, offset, expected);
+		errors = CheckAll(occupancy, hash_data, offset, expected);
+	}
+	if (errors > 0) {
+		std::cout << "The framebuffer decode differs at " << errors
+			<< " byte(s)." << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "The framebuffer decode is identical." << std::endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,346 @@
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include "entropy.h"
+#include "pipeline.h"
+
+// rANS with 12 bit probabilities and a 32 bit state, renormalized a byte
+// at a time; the state stays within [RANS_L, RANS_L << 8)
+static const unsigned int PROB_BITS = 12;
+static const unsigned int PROB_SCALE = 1u << PROB_BITS;
+static const unsigned int RANS_L = 1u << 23;
+
+// chunk size and decoding threads for .rans files written by CodedFile
+static const std::size_t CODED_CHUNK = 1 << 16;
+static const int CODED_THREADS = 4;
+
+// ====================================================================
+// helpers
+// ====================================================================
+
+// scale the byte counts of a chunk so they sum to PROB_SCALE, keeping
+// every byte that occurs at a frequency of at least 1
+static void Normalize(const unsigned char *in, std::size_t n, unsigned int *freq) {
+  std::size_t count[256];
+  int sum = 0, top = 0;
+  memset(count, 0, sizeof(count));
+  for (std::size_t i = 0; i < n; i++)
+    count[in[i]]++;
+  for (int s = 0; s < 256; s++) {
+    freq[s] = 0;
+    if (count[s]) {
+      freq[s] = std::max(1u, (unsigned int) ((double) count[s] * PROB_SCALE / n));
+      sum += freq[s];
+      if (freq[s] > freq[top]) top = s;
+    }
+  }
+  // hand the rounding error to the most frequent bytes
+  int diff = PROB_SCALE - sum;
+  if (diff >= 0) {
+    freq[top] += diff;
+    return;
+  }
+  while (diff < 0) {
+    for (int s = 0; s < 256 && diff < 0; s++) {
+      if (freq[s] > 1 && freq[s] * 2 >= freq[top]) {
+        freq[s]--;
+        diff++;
+      }
+    }
+    top = 0;
+    for (int s = 0; s < 256; s++)
+      if (freq[s] > freq[top]) top = s;
+  }
+}
+
+static void EncodeChunk(const unsigned char *in, std::size_t n,
+                        std::vector<unsigned char> &out) {
+  unsigned int freq[256], cum[257];
+  Normalize(in, n, freq);
+  cum[0] = 0;
+  for (int s = 0; s < 256; s++)
+    cum[s+1] = cum[s] + freq[s];
+  assert (cum[256] == PROB_SCALE);
+
+  // the table: how many bytes occur (0 for all 256), then each of them
+  // with its frequency, high byte first
+  int present = 0;
+  for (int s = 0; s < 256; s++)
+    present += (freq[s] > 0);
+  out.push_back(present & 0xFF);
+  for (int s = 0; s < 256; s++) {
+    if (freq[s]) {
+      out.push_back(s);
+      out.push_back(freq[s] >> 8);
+      out.push_back(freq[s] & 0xFF);
+    }
+  }
+
+  // rANS codes back to front, so collect the bytes reversed
+  std::vector<unsigned char> rev;
+  unsigned int x = RANS_L;
+  for (std::size_t i = n; i-- > 0; ) {
+    unsigned int f = freq[in[i]];
+    unsigned int x_max = ((RANS_L >> PROB_BITS) << 8) * f;
+    while (x >= x_max) {
+      rev.push_back(x & 0xFF);
+      x >>= 8;
+    }
+    x = ((x / f) << PROB_BITS) + (x % f) + cum[in[i]];
+  }
+  rev.push_back(x >> 24);
+  rev.push_back((x >> 16) & 0xFF);
+  rev.push_back((x >> 8) & 0xFF);
+  rev.push_back(x & 0xFF);
+  out.insert(out.end(), rev.rbegin(), rev.rend());
+}
+
+// decodes a range of chunks on a pool thread
+class DecodeTask : public Task {
+public:
+  DecodeTask(const Chunked &c, unsigned char *o, std::size_t f, std::size_t s) :
+    coded(c), out(o), first(f), step(s) {}
+  void Run() {
+    for (std::size_t i = first; i < coded.Chunks(); i += step)
+      coded.DecodeChunk(i, out + i * coded.ChunkSize());
+  }
+private:
+  const Chunked &coded;
+  unsigned char *out;
+  std::size_t first, step;
+};
+
+// ====================================================================
+// Chunked
+// ====================================================================
+void Chunked::Encode(const unsigned char *data, std::size_t n, std::size_t chunk) {
+  assert (chunk > 0);
+  size = n;
+  chunk_size = chunk;
+  bytes.clear();
+  starts.assign(1, 0);
+  for (std::size_t at = 0; at < n; at += chunk) {
+    std::size_t k = std::min(chunk, n - at);
+    EncodeChunk(data + at, k, bytes);
+    // a chunk that does not get smaller is stored as it is
+    if (bytes.size() - starts.back() >= k) {
+      bytes.resize(starts.back());
+      bytes.insert(bytes.end(), data + at, data + at + k);
+    }
+    starts.push_back(bytes.size());
+  }
+}
+
+void Chunked::DecodeChunk(std::size_t i, unsigned char *out) const {
+  assert (i < Chunks());
+  const unsigned char *p = &bytes[0] + starts[i];
+  const unsigned char *end = &bytes[0] + starts[i+1];
+  std::size_t n = std::min(chunk_size, size - i * chunk_size);
+  if ((std::size_t) (end - p) == n) {
+    memcpy(out, p, n);
+    return;
+  }
+
+  // the table
+  unsigned int freq[256], cum[257];
+  unsigned char lookup[PROB_SCALE];
+  memset(freq, 0, sizeof(freq));
+  int present = (p < end) ? *p++ : 0;
+  if (present == 0) present = 256;
+  for (int k = 0; k < present && p + 3 <= end; k++) {
+    freq[p[0]] = (p[1] << 8) | p[2];
+    p += 3;
+  }
+  cum[0] = 0;
+  for (int s = 0; s < 256; s++) {
+    cum[s+1] = cum[s] + freq[s];
+    if (cum[s+1] > PROB_SCALE) {
+      std::cerr << "Corrupt chunk " << i << " in rANS stream\n";
+      memset(out, 0, n);
+      return;
+    }
+    for (unsigned int slot = cum[s]; slot < cum[s+1]; slot++)
+      lookup[slot] = s;
+  }
+
+  // the state, then one byte per step
+  unsigned int x = 0;
+  for (int k = 0; k < 4; k++)
+    x |= (unsigned int) ((p < end) ? *p++ : 0) << (8 * k);
+  for (std::size_t j = 0; j < n; j++) {
+    unsigned int slot = x & (PROB_SCALE - 1);
+    unsigned char s = lookup[slot];
+    out[j] = s;
+    x = freq[s] * (x >> PROB_BITS) + slot - cum[s];
+    while (x < RANS_L)
+      x = (x << 8) | ((p < end) ? *p++ : 0);
+  }
+}
+
+void Chunked::Decode(std::vector<unsigned char> &out, int threads) const {
+  out.resize(size);
+  if (size == 0)
+    return;
+  threads = std::max(1, std::min<int>(threads, Chunks()));
+  if (threads == 1) {
+    DecodeTask(*this, &out[0], 0, 1).Run();
+    return;
+  }
+  std::vector<DecodeTask> tasks;
+  for (int t = 0; t < threads; t++)
+    tasks.push_back(DecodeTask(*this, &out[0], t, threads));
+  Pool pool(threads);
+  for (int t = 0; t < threads; t++)
+    pool.Start(&tasks[t]);
+  pool.Join();
+}
+
+std::size_t Chunked::FileSize() const {
+  char tmp[100];
+  int header = sprintf(tmp, "RANS\n%lu %lu\n%lu\n", (unsigned long) size,
+                       (unsigned long) chunk_size, (unsigned long) Chunks());
+  return header + 4 * Chunks() + bytes.size();
+}
+
+bool Chunked::Save(const std::string &filename) const {
+  int len = filename.length();
+  if (!(len > 5 && filename.substr(len-5) == std::string(".rans"))) {
+    std::cerr << "ERROR: This is not a RANS filename: " << filename << std::endl;
+    return false;
+  }
+  FILE *file = fopen(filename.c_str(), "wb");
+  if (file == NULL) {
+    std::cerr << "Unable to open " << filename << " for writing\n";
+    return false;
+  }
+
+  // misc header information
+  fprintf (file, "RANS\n");
+  fprintf (file, "%lu %lu\n", (unsigned long) size, (unsigned long) chunk_size);
+  fprintf (file, "%lu\n", (unsigned long) Chunks());
+  // the coded size of each chunk (high byte first), then the chunks
+  for (std::size_t i = 0; i < Chunks(); i++) {
+    unsigned long n = starts[i+1] - starts[i];
+    fputc ((n >> 24) & 0xFF, file);
+    fputc ((n >> 16) & 0xFF, file);
+    fputc ((n >> 8) & 0xFF, file);
+    fputc (n & 0xFF, file);
+  }
+  if (!bytes.empty())
+    fwrite(&bytes[0], sizeof(unsigned char), bytes.size(), file);
+  // a full disk shows up once the buffered bytes are flushed
+  if (fclose(file) != 0) {
+    std::cerr << "Unable to write " << filename << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool Chunked::Load(const std::string &filename) {
+  int len = filename.length();
+  if (!(len > 5 && filename.substr(len-5) == std::string(".rans"))) {
+    std::cerr << "ERROR: This is not a RANS filename: " << filename << std::endl;
+    return false;
+  }
+  FILE *file = fopen(filename.c_str(), "rb");
+  if (file == NULL) {
+    std::cerr << "Unable to open " << filename << " for reading\n";
+    return false;
+  }
+
+  // misc header information
+  char tmp[100];
+  unsigned long s = 0, c = 0, n = 0;
+  fgets(tmp,100,file); 
+  assert (strstr(tmp,"RANS"));
+  fgets(tmp,100,file); 
+  sscanf(tmp,"%lu %lu",&s,&c);
+  fgets(tmp,100,file); 
+  sscanf(tmp,"%lu",&n);
+  size = s;
+  chunk_size = c;
+  // the chunk sizes, then the chunks
+  starts.assign(1, 0);
+  for (unsigned long i = 0; i < n; i++) {
+    unsigned long k = 0;
+    for (int b = 0; b < 4; b++)
+      k = (k << 8) | (fgetc(file) & 0xFF);
+    starts.push_back(starts.back() + k);
+  }
+  bytes.resize(starts.back());
+  bool ok = bytes.empty() ||
+    fread(&bytes[0], sizeof(unsigned char), bytes.size(), file) == bytes.size();
+  fclose(file);
+  if (!ok || (chunk_size == 0 && size > 0) ||
+      (size > 0 && (size - 1) / chunk_size + 1 != Chunks())) {
+    std::cerr << "Truncated or corrupt rANS file " << filename << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// ====================================================================
+// CodedFile
+// ====================================================================
+std::string CodedFile::Plain(const std::string &filename) {
+  int len = filename.length();
+  if (len > 5 && filename.substr(len-5) == std::string(".rans"))
+    return filename.substr(0, len-5);
+  return filename;
+}
+
+FILE *CodedFile::Open(const std::string &filename, const char *mode) {
+  Close();
+  name = filename;
+  writing = (mode[0] == 'w');
+  if (Plain(filename) == filename) {
+    file = fopen(filename.c_str(), mode);
+  } else if (writing) {
+    // collect the plain bytes, to be coded on Close
+    file = tmpfile();
+  } else {
+    Chunked coded;
+    std::vector<unsigned char> plain;
+    if (!coded.Load(filename))
+      return NULL;
+    coded.Decode(plain, CODED_THREADS);
+    file = tmpfile();
+    if (file == NULL)
+      return NULL;
+    if (!plain.empty() &&
+        fwrite(&plain[0], sizeof(unsigned char), plain.size(), file) != plain.size()) {
+      fclose(file);
+      file = NULL;
+      return NULL;
+    }
+    rewind(file);
+  }
+  return file;
+}
+
+bool CodedFile::Close() {
+  if (file == NULL)
+    return true;
+  bool ok = true;
+  if (writing && Plain(name) != name) {
+    // read the plain bytes back, then code them
+    std::vector<unsigned char> plain;
+    unsigned char tmp[1 << 12];
+    std::size_t n;
+    ok = (fflush(file) == 0);
+    rewind(file);
+    while ((n = fread(tmp, sizeof(unsigned char), sizeof(tmp), file)) > 0)
+      plain.insert(plain.end(), tmp, tmp + n);
+    ok = ok && !ferror(file);
+    if (ok) {
+      Chunked coded;
+      coded.Encode(plain.empty() ? NULL : &plain[0], plain.size(), CODED_CHUNK);
+      ok = coded.Save(name);
+    }
+  }
+  ok = (fclose(file) == 0) && ok;
+  file = NULL;
+  return ok;
+}
@@ -0,0 +1,91 @@
+#ifndef _ENTROPY_H_
+#define _ENTROPY_H_
+
+#include <cstdio>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// ====================================================================
+// ====================================================================
+// CHUNKED rANS CODING
+//    a byte stream is cut into fixed-size chunks, and each chunk is
+//    coded on its own (order 0 statistics, 12 bit probabilities), so
+//    any chunk can be decoded without the others and all of them can
+//    be decoded side by side (a chunk that coding would not shrink is
+//    stored as it is); saved as this custom format:
+//      .rans
+//
+
+class Chunked {
+public:
+  Chunked() : size(0), chunk_size(0) {}
+
+  // ========
+  // ENCODING
+  void Encode(const unsigned char *data, std::size_t n, std::size_t chunk);
+
+  // ========
+  // DECODING
+  // the whole stream, on up to threads threads
+  void Decode(std::vector<unsigned char> &out, int threads = 1) const;
+  // chunk i alone, bytes [i * ChunkSize(), ...) of the stream
+  void DecodeChunk(std::size_t i, unsigned char *out) const;
+
+  // =========
+  // ACCESSORS
+  std::size_t Size() const { return size; }
+  std::size_t ChunkSize() const { return chunk_size; }
+  std::size_t Chunks() const { return starts.empty() ? 0 : starts.size() - 1; }
+  std::size_t CodedSize() const { return bytes.size(); }
+  // the size of the .rans file, header included
+  std::size_t FileSize() const;
+
+  // ===========
+  // LOAD & SAVE
+  bool Load(const std::string &filename);
+  bool Save(const std::string &filename) const;
+
+private:
+  // ==============
+  // REPRESENTATION
+  std::size_t size;
+  std::size_t chunk_size;
+  // chunk i is bytes [starts[i], starts[i+1])
+  std::vector<std::size_t> starts;
+  std::vector<unsigned char> bytes;
+};
+
+
+// ====================================================================
+// ====================================================================
+// CODED FILES
+//    any of the formats in image.h can be kept entropy coded on disk
+//    by adding .rans to its filename (like data.ppm.rans); Open gives
+//    a FILE that reads or writes the plain bytes in a tmpfile(), and
+//    Close does the coding (only standard C streams, so this builds
+//    wherever the rest of the tree does)
+//
+
+class CodedFile {
+public:
+  CodedFile() : file(NULL), writing(false) {}
+  ~CodedFile() { Close(); }
+
+  // the filename without any .rans suffix, to check its format by
+  static std::string Plain(const std::string &filename);
+
+  // mode is "rb" or "wb"
+  FILE *Open(const std::string &filename, const char *mode);
+  bool Close();
+
+private:
+  CodedFile(const CodedFile &);
+  const CodedFile& operator=(const CodedFile &);
+
+  std::string name;
+  FILE *file;
+  bool writing;
+};
+
+#endif
@@ -7,12 +7,14 @@
 // ====================================================================
 template <>
 bool Image<Color>::Save(const std::string &filename) const {
-  int len = filename.length();
-  if (!(len > 4 && filename.substr(len-4) == std::string(".ppm"))) {
+  std::string name = CodedFile::Plain(filename);
+  int len = name.length();
+  if (!(len > 4 && name.substr(len-4) == std::string(".ppm"))) {
     std::cerr << "ERROR: This is not a PPM filename: " << filename << std::endl;
     return false;
   }
-  FILE *file = fopen(filename.c_str(), "wb");
+  CodedFile coded;
+  FILE *file = coded.Open(filename, "wb");
   if (file == NULL) {
     std::cerr << "Unable to open " << filename << " for writing\n";
     return false;
@@ -33,18 +35,19 @@ bool Image<Color>::Save(const std::string &filename) const {
       fputc(v.blue,  file);
     }
   }
-  fclose(file);
-  return true;
+  return coded.Close();
 }
 
 template <>
 bool Image<Color>::Load(const std::string &filename) {
-  int len = filename.length();
-  if (!(len > 4 && filename.substr(len-4) == std::string(".ppm"))) {
+  std::string name = CodedFile::Plain(filename);
+  int len = name.length();
+  if (!(len > 4 && name.substr(len-4) == std::string(".ppm"))) {
     std::cerr << "ERROR: This is not a PPM filename: " << filename << std::endl;
     return false;
   }
-  FILE *file = fopen(filename.c_str(),"rb");
+  CodedFile coded;
+  FILE *file = coded.Open(filename, "rb");
   if (file == NULL) {
     std::cerr << "Unable to open " << filename << " for reading\n";
     return false;
@@ -73,8 +76,7 @@ bool Image<Color>::Load(const std::string &filename) {
       SetPixel(x,y,c);
     }
   }
-  fclose(file);
-  return true;
+  return coded.Close();
 }
 
 // ====================================================================
@@ -82,12 +84,14 @@ bool Image<Color>::Load(const std::string &filename) {
 // ====================================================================
 template <>
 bool Image<bool>::Save(const std::string &filename) const {
-  int len = filename.length();
-  if (!(len > 4 && filename.substr(len-4) == std::string(".pbm"))) {
+  std::string name = CodedFile::Plain(filename);
+  int len = name.length();
+  if (!(len > 4 && name.substr(len-4) == std::string(".pbm"))) {
     std::cerr << "ERROR: This is not a PBM filename: " << filename << std::endl;
     return false;
   }
-  FILE *file = fopen(filename.c_str(), "wb");
+  CodedFile coded;
+  FILE *file = coded.Open(filename, "wb");
   if (file == NULL) {
     std::cerr << "Unable to open " << filename << " for writing\n";
     return false;
@@ -129,20 +133,21 @@ bool Image<bool>::Save(const std::string &filename) const {
     fwrite((void *)packedData, sizeof(unsigned char), rowsize, file);     		
   }
   
-  fclose(file);
   delete [] packedData;
-  return true;
+  return coded.Close();
 }
 
 template <>
 bool Image<bool>::Load(const std::string &filename) {
 
-  int len = filename.length();
-  if (!(len > 4 && filename.substr(len-4) == std::string(".pbm"))) {
+  std::string name = CodedFile::Plain(filename);
+  int len = name.length();
+  if (!(len > 4 && name.substr(len-4) == std::string(".pbm"))) {
     std::cerr << "ERROR: This is not a PBM filename: " << filename << std::endl;
     return false;
   }
-  FILE *file = fopen(filename.c_str(), "rb");
+  CodedFile coded;
+  FILE *file = coded.Open(filename, "rb");
   if (file == NULL) {
     std::cerr << "Unable to open " << filename << " for reading\n";
     return false;
@@ -201,9 +206,8 @@ bool Image<bool>::Load(const std::string &filename) {
   }
   
   // close the file
-  fclose(file);
   delete [] packedData;
-  return true;
+  return coded.Close();
 }
 
 // ====================================================================
@@ -211,12 +215,14 @@ bool Image<bool>::Load(const std::string &filename) {
 // ====================================================================
 template <>
 bool Image<Offset>::Save(const std::string &filename) const {
-  int len = filename.length();
-  if (!(len > 7 && filename.substr(len-7) == std::string(".offset"))) {
+  std::string name = CodedFile::Plain(filename);
+  int len = name.length();
+  if (!(len > 7 && name.substr(len-7) == std::string(".offset"))) {
     std::cerr << "ERROR: This is not a OFFSET filename: " << filename << std::endl;
     return false;
   }
-  FILE *file = fopen(filename.c_str(), "wb");
+  CodedFile coded;
+  FILE *file = coded.Open(filename, "wb");
   if (file == NULL) {
     std::cerr << "Unable to open " << filename << " for writing\n";
     return false;
@@ -237,18 +243,19 @@ bool Image<Offset>::Save(const std::string &filename) const {
       fputc (c,file);
     }
   }
-  fclose(file);
-  return true;
+  return coded.Close();
 }
 
 template <>
 bool Image<Offset>::Load(const std::string &filename) {
-  int len = filename.length();
-  if (!(len > 7 && filename.substr(len-7) == std::string(".offset"))) {
+  std::string name = CodedFile::Plain(filename);
+  int len = name.length();
+  if (!(len > 7 && name.substr(len-7) == std::string(".offset"))) {
     std::cerr << "ERROR: This is not a OFFSET filename: " << filename << std::endl;
     return false;
   }
-  FILE *file = fopen(filename.c_str(),"rb");
+  CodedFile coded;
+  FILE *file = coded.Open(filename, "rb");
   if (file == NULL) {
     std::cerr << "Unable to open " << filename << " for reading\n";
     return false;
@@ -279,10 +286,331 @@ bool Image<Offset>::Load(const std::string &filename) {
       SetPixel(x,y,offset);
     }
   }
-  fclose(file);
+  return coded.Close();
+}
+
+
+// ====================================================================
+// CheckTable (.check)
+// ====================================================================
+bool CheckTable::Save(const std::string &filename) const {
+  std::string name = CodedFile::Plain(filename);
+  int len = name.length();
+  if (!(len > 6 && name.substr(len-6) == std::string(".check"))) {
+    std::cerr << "ERROR: This is not a CHECK filename: " << filename << std::endl;
+    return false;
+  }
+  CodedFile coded;
+  FILE *file = coded.Open(filename, "wb");
+  if (file == NULL) {
+    std::cerr << "Unable to open " << filename << " for writing\n";
+    return false;
+  }
+
+  // misc header information
+  // (a 1 bit tag is 1 for every full slot, so it tells nothing apart)
+  if (bits < 2 || bits > 8) {
+    std::cerr << "ERROR: check tags need 2 to 8 bits, not " << bits << std::endl;
+    coded.Close();
+    return false;
+  }
+  fprintf (file, "CHECK\n");
+  fprintf (file, "%d %d\n", width,height);
+  fprintf (file, "%d %d\n", tags.Width(),tags.Height());
+  fprintf (file, "%d\n", bits);
+  // the data, packed bits per tag (high bits first)
+  // flip y so that (0,0) is bottom left corner
+  unsigned int packed_d = 0;
+  int filled = 0;
+  for (int y = tags.Height()-1; y >= 0; y--) {
+    for (int x = 0; x < tags.Width(); x++) {
+      unsigned char t = tags.GetPixel(x,y);
+      assert (t < (1 << bits));
+      packed_d = (packed_d << bits) | t;
+      filled += bits;
+      while (filled >= 8) {
+        filled -= 8;
+        fputc ((packed_d >> filled) & 0xFF, file);
+      }
+    }
+  }
+  // special case when not enough bits to fill last byte
+  if (filled > 0)
+    fputc ((packed_d << (8-filled)) & 0xFF, file);
+  return coded.Close();
+}
+
+bool CheckTable::Load(const std::string &filename) {
+  std::string name = CodedFile::Plain(filename);
+  int len = name.length();
+  if (!(len > 6 && name.substr(len-6) == std::string(".check"))) {
+    std::cerr << "ERROR: This is not a CHECK filename: " << filename << std::endl;
+    return false;
+  }
+  CodedFile coded;
+  FILE *file = coded.Open(filename, "rb");
+  if (file == NULL) {
+    std::cerr << "Unable to open " << filename << " for reading\n";
+    return false;
+  }
+
+  // misc header information
+  char tmp[100];
+  int tw, th;
+  fgets(tmp,100,file); 
+  assert (strstr(tmp,"CHECK"));
+  fgets(tmp,100,file); 
+  while (tmp[0] == '#') 
+    fgets(tmp,100,file); 
+  sscanf(tmp,"%d %d",&width,&height);
+  fgets(tmp,100,file); 
+  sscanf(tmp,"%d %d",&tw,&th);
+  fgets(tmp,100,file); 
+  sscanf(tmp,"%d",&bits);
+  if (bits < 2 || bits > 8) {
+    std::cerr << "ERROR: check tags need 2 to 8 bits, not " << bits << std::endl;
+    coded.Close();
+    return false;
+  }
+  // the data
+  tags.Allocate(tw,th);
+  unsigned int packed_d = 0;
+  int filled = 0;
+  // flip y so that (0,0) is bottom left corner
+  for (int y = th-1; y >= 0; y--) {
+    for (int x = 0; x < tw; x++) {
+      while (filled < bits) {
+        packed_d = (packed_d << 8) | (fgetc(file) & 0xFF);
+        filled += 8;
+      }
+      filled -= bits;
+      tags.SetPixel(x,y,(packed_d >> filled) & ((1 << bits) - 1));
+    }
+  }
+  return coded.Close();
+}
+
+
+// ====================================================================
+// PointList (.pts and .txt)
+// ====================================================================
+bool PointList::Save(const std::string &filename) const {
+  std::string name = CodedFile::Plain(filename);
+  int len = name.length();
+  bool text = (len > 4 && name.substr(len-4) == std::string(".txt"));
+  if (!text && !(len > 4 && name.substr(len-4) == std::string(".pts"))) {
+    std::cerr << "ERROR: This is not a POINTS filename: " << filename << std::endl;
+    return false;
+  }
+  CodedFile coded;
+  FILE *file = coded.Open(filename, text ? "w" : "wb");
+  if (file == NULL) {
+    std::cerr << "Unable to open " << filename << " for writing\n";
+    return false;
+  }
+
+  if (text) {
+    fprintf (file, "%d %d\n", width,height);
+    for (unsigned int i = 0; i < points.size(); i++) {
+      const Point &p = points[i];
+      fprintf (file, "%d %d %d %d %d\n", p.x, p.y,
+               p.color.red, p.color.green, p.color.blue);
+    }
+  } else {
+    // misc header information
+    assert (width <= 0x10000 && height <= 0x10000);
+    fprintf (file, "POINTS\n");
+    fprintf (file, "%d %d\n", width,height);
+    fprintf (file, "%d\n", (int) points.size());
+    // the data, high byte first
+    for (unsigned int i = 0; i < points.size(); i++) {
+      const Point &p = points[i];
+      fputc ((p.x >> 8) & 0xFF, file);
+      fputc (p.x & 0xFF, file);
+      fputc ((p.y >> 8) & 0xFF, file);
+      fputc (p.y & 0xFF, file);
+      fputc (p.color.red,   file);
+      fputc (p.color.green, file);
+      fputc (p.color.blue,  file);
+    }
+  }
+  return coded.Close();
+}
+
+// report a line of a point list that cannot be read, then give up
+static bool Malformed(CodedFile &coded, const std::string &filename,
+                      int line, const char *what) {
+  std::cerr << "ERROR: " << filename << ":" << line << ": " << what << std::endl;
+  coded.Close();
+  return false;
+}
+
+bool PointList::Load(const std::string &filename) {
+  std::string name = CodedFile::Plain(filename);
+  int len = name.length();
+  bool text = (len > 4 && name.substr(len-4) == std::string(".txt"));
+  if (!text && !(len > 4 && name.substr(len-4) == std::string(".pts"))) {
+    std::cerr << "ERROR: This is not a POINTS filename: " << filename << std::endl;
+    return false;
+  }
+  CodedFile coded;
+  FILE *file = coded.Open(filename, text ? "r" : "rb");
+  if (file == NULL) {
+    std::cerr << "Unable to open " << filename << " for reading\n";
+    return false;
+  }
+
+  char tmp[100];
+  int n = 0, line = 1;
+  points.clear();
+  if (!text) {
+    if (!fgets(tmp,100,file) || !strstr(tmp,"POINTS"))
+      return Malformed(coded, filename, line, "expected \"POINTS\"");
+    line++;
+  }
+  if (!fgets(tmp,100,file))
+    tmp[0] = '\0';
+  while (tmp[0] == '#') {
+    if (!fgets(tmp,100,file))
+      tmp[0] = '\0';
+    line++;
+  }
+  if (sscanf(tmp,"%d %d",&width,&height) != 2 || width <= 0 || height <= 0)
+    return Malformed(coded, filename, line, "expected a positive \"width height\"");
+  if (text) {
+    // one point per line, skipping comments and blank lines
+    while (fgets(tmp,100,file)) {
+      Point p;
+      int r, g, b;
+      char extra;
+      line++;
+      if (tmp[0] == '#' || tmp[strspn(tmp," \t\r\n")] == '\0') continue;
+      if (sscanf(tmp,"%d %d %d %d %d %c",&p.x,&p.y,&r,&g,&b,&extra) != 5)
+        return Malformed(coded, filename, line, "expected \"x y red green blue\"");
+      if (r < 0 || r > 255 || g < 0 || g > 255 || b < 0 || b > 255)
+        return Malformed(coded, filename, line, "color components must lie in 0..255");
+      p.color = Color(r,g,b);
+      points.push_back(p);
+    }
+  } else {
+    line++;
+    if (!fgets(tmp,100,file) || sscanf(tmp,"%d",&n) != 1 || n < 0)
+      return Malformed(coded, filename, line, "expected a point count of 0 or more");
+    // the data, high byte first, 7 bytes per point
+    unsigned char d[7];
+    for (int i = 0; i < n; i++) {
+      if (fread(d, sizeof(unsigned char), 7, file) != 7) {
+        std::cerr << "ERROR: " << filename << ": truncated after " << i
+                  << " of " << n << " points" << std::endl;
+        coded.Close();
+        return false;
+      }
+      Point p;
+      p.x = (d[0] << 8) | d[1];
+      p.y = (d[2] << 8) | d[3];
+      p.color = Color(d[4],d[5],d[6]);
+      points.push_back(p);
+    }
+  }
+  return coded.Close();
+}
+
+// ====================================================================
+// RowReader<bool> (.pbm)
+// ====================================================================
+template <>
+bool RowReader<bool>::Open(const std::string &filename) {
+  std::string name = CodedFile::Plain(filename);
+  int len = name.length();
+  if (!(len > 4 && name.substr(len-4) == std::string(".pbm"))) {
+    std::cerr << "ERROR: This is not a PBM filename: " << filename << std::endl;
+    return false;
+  }
+  Close();
+  file = coded.Open(filename, "rb");
+  if (file == NULL) {
+    std::cerr << "Unable to open " << filename << " for reading\n";
+    return false;
+  }
+
+  char buffer[100];
+  // read file identifier (magic number)
+  fgets (buffer, sizeof (buffer), file);
+  if ((buffer[0] != 'P') || (buffer[1] != '4'))
+    {
+      std::cerr << "Not a simple pbm file\n";
+      Close();
+      return false;
+    }
+  // read image size, skipping comments and stray newlines
+  do {
+    fgets (buffer, sizeof (buffer), file);  
+  } while (buffer[0] == '#' || buffer[0] == 10);
+  sscanf (buffer, "%d %d", &width, &height);
+  packed = new unsigned char[(width + 7) / 8];
   return true;
 }
 
+template <>
+bool RowReader<bool>::Read(bool *row) {
+  int rowsize = (width + 7) / 8;
+  if (file == NULL || fread(packed, sizeof(char), rowsize, file) != (size_t) rowsize)
+    return false;
+  for (int x = 0; x < width; ++x) {
+    // in a .pbm file, 1 == true == black
+    row[x] = ((packed[x / 8] >> (7 - x % 8)) & 1) == 1;
+  }
+  return true;
+}
+
+// ====================================================================
+// RowWriter<Color> (.ppm)
+// ====================================================================
+template <>
+bool RowWriter<Color>::Open(const std::string &filename, int w, int h) {
+  std::string name = CodedFile::Plain(filename);
+  int len = name.length();
+  if (!(len > 4 && name.substr(len-4) == std::string(".ppm"))) {
+    std::cerr << "ERROR: This is not a PPM filename: " << filename << std::endl;
+    return false;
+  }
+  Close();
+  file = coded.Open(filename, "wb");
+  if (file == NULL) {
+    std::cerr << "Unable to open " << filename << " for writing\n";
+    return false;
+  }
+  width = w;
+  height = h;
+  packed = new unsigned char[3 * width];
+
+  // misc header information
+  fprintf (file, "P6\n");
+  fprintf (file, "%d %d\n", width,height);
+  fprintf (file, "255\n");
+  return true;
+}
+
+template <>
+bool RowWriter<Color>::Write(const unsigned char *row) {
+  if (file == NULL)
+    return false;
+  return fwrite(row, sizeof(unsigned char), 3 * width, file) == (size_t) (3 * width);
+}
+
+template <>
+bool RowWriter<Color>::Write(const Color *row) {
+  if (file == NULL)
+    return false;
+  for (int x = 0; x < width; ++x) {
+    packed[3*x]   = row[x].red;
+    packed[3*x+1] = row[x].green;
+    packed[3*x+2] = row[x].blue;
+  }
+  return Write(packed);
+}
+
+
 
 // ====================================================================
 // ====================================================================
@@ -2,8 +2,11 @@
 #define _IMAGE_H_
 
 #include <cassert>
+#include <cstdio>
 #include <string>
 #include <iostream>
+#include <vector>
+#include "entropy.h"
 
 // ====================================================================
 // 24 bit color pixel
@@ -38,6 +41,7 @@ struct Offset {
 //      .pbm    (when T == bool)
 //    and this custom file format:
 //      .offset (when T == Offset)
+//    any of which can be entropy coded on disk, see CodedFile
 //
 
 template <class T>
@@ -111,4 +115,131 @@ private:
   T *data;
 };
 
+
+// ====================================================================
+// ====================================================================
+// CHECK TABLE
+//    stands in for the occupancy image, saved as this custom format:
+//      .check
+//    every hash slot keeps a small tag (2 to 8 bits) derived from the
+//    coordinates of the pixel that owns it, 0 when the slot is empty
+//
+
+struct CheckTable {
+  CheckTable() : width(0), height(0), bits(8) {}
+
+  // size of the decoded image, and bits kept per tag
+  int width;
+  int height;
+  int bits;
+  // one tag per hash slot
+  Image<unsigned char> tags;
+
+  // ===========
+  // LOAD & SAVE
+  bool Load(const std::string &filename);
+  bool Save(const std::string &filename) const;
+};
+
+
+// ====================================================================
+// ====================================================================
+// POINT LIST
+//    only the non-white pixels of an image, with its size, saved as
+//    one of these custom formats:
+//      .pts    (binary, x and y in 16 bits each then red, green, blue)
+//      .txt    (text, "x y r g b" on each line after "width height")
+//    (0,0) is the bottom left corner, as in Image
+//
+
+struct Point {
+  int x, y;
+  Color color;
+};
+
+struct PointList {
+  PointList() : width(0), height(0) {}
+
+  // size of the image the points belong to
+  int width;
+  int height;
+  std::vector<Point> points;
+
+  // ===========
+  // LOAD & SAVE
+  bool Load(const std::string &filename);
+  bool Save(const std::string &filename) const;
+};
+
+// ====================================================================
+// ====================================================================
+// ROW STREAMS
+//    read or write an image one row at a time, in file order (the top
+//    row, y == height-1, comes first), so that I/O can overlap with work
+//    on the rows already in memory:
+//      .pbm    (RowReader<bool>)
+//      .ppm    (RowWriter<Color>)
+//
+
+template <class T>
+class RowReader {
+public:
+  RowReader() : file(NULL), packed(NULL), width(0), height(0) {}
+  ~RowReader() { Close(); }
+
+  int Width() const { return width; }
+  int Height() const { return height; }
+
+  // read the header, then one row of width pixels per call
+  bool Open(const std::string &filename);
+  bool Read(T *row);
+  void Close() {
+    coded.Close();
+    delete [] packed;
+    file = NULL;
+    packed = NULL;
+  }
+
+private:
+  RowReader(const RowReader &);
+  const RowReader& operator=(const RowReader &);
+
+  CodedFile coded;
+  FILE *file;
+  unsigned char *packed;
+  int width;
+  int height;
+};
+
+template <class T>
+class RowWriter {
+public:
+  RowWriter() : file(NULL), packed(NULL), width(0), height(0) {}
+  ~RowWriter() { Close(); }
+
+  // write the header, then one row of width pixels per call
+  // (or one row already packed as it is stored in the file)
+  bool Open(const std::string &filename, int w, int h);
+  bool Write(const T *row);
+  bool Write(const unsigned char *row);
+  // false when the file could not be finished
+  bool Close() {
+    bool ok = coded.Close();
+    delete [] packed;
+    file = NULL;
+    packed = NULL;
+    return ok;
+  }
+
+private:
+  RowWriter(const RowWriter &);
+  const RowWriter& operator=(const RowWriter &);
+
+  CodedFile coded;
+  FILE *file;
+  unsigned char *packed;
+  int width;
+  int height;
+};
+
 #endif
@@ -1,10 +1,15 @@
+#include <cstdio>
 #include <cstdlib>
 #include <cmath>
+#include <ctime>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
 #include <utility>
 #include <vector>
+#include <sys/time.h>
 
 #ifndef NDEBUG
-#include <iomanip>
 #define FMT(X) std::right << std::setw(42) << X
 #define PCT(X) std::fixed << std::setprecision(2) << FMT(X) * 100. << "%"
 #endif
@@ -16,7 +21,9 @@
 #include <unordered_set>
 #endif // C++
 
+#include "decode.h"
 #include "image.h"
+#include "pipeline.h"
 
 namespace std {
 #if __cplusplus == 199711L
@@ -45,43 +52,41 @@ typedef std::tr1::unordered_set<Color> BUCKET;
 typedef std::unordered_set<Color> BUCKET;
 #endif // C++
 typedef std::vector<int> ROW;
+typedef std::pair<int, int> XY;
+typedef std::vector<XY> POINTS;
+typedef std::vector<Color> COLORS;
 static const Color WHITE(255, 255, 255);
 static const Offset ZERO(0, 0);
 
 static int
 Try(
-		const Image<Color> &input, const Image<Offset> &offset,
+		const POINTS &all, const COLORS &values, const Image<Offset> &offset,
 		BUCKET *hash, const int s_hash, std::pair<int, int> &loc)
 {
-	int iw, ih, ow, oh, mode, collisions = 0;
+	int x, y, ow, oh, mode = 0, collisions = 0;
 	assert(hash);
-	iw = input.Width();
-	ih = input.Height();
 	ow = offset.Width();
 	oh = offset.Height();
 	/* Track hits into the offset table */
 	std::vector<ROW> hits(ow, ROW(oh, 0));
 	/* Run the hashing as currently offset */
 	std::pair<int, int> xy;
-	for (int x = 0; x < iw; ++x) {
-		for (int y = 0; y < ih; ++y) {
-			Color c = input.GetPixel(x, y);
-			if (!(c == WHITE)) {
-				/* Lookup where this falls in offset */
-				xy = std::make_pair(x % ow, y % oh);
-				if (++hits[xy.first][xy.second] > mode) {
-					mode = hits[xy.first][xy.second];
-					loc = xy;
-				}
-				/* Use this offset to hash */
-				Offset o = offset.GetPixel(xy.first, xy.second);
-				xy = std::make_pair((x + o.dx) % s_hash, (y + o.dy) % s_hash);
-				BUCKET *bucket = &hash[xy.first * s_hash + xy.second];
-				/* Mark any collisions */
-				if (!bucket->empty()) ++collisions;
-				bucket->insert(c);
-			}
+	for (std::size_t i = 0; i < all.size(); ++i) {
+		x = all[i].first;
+		y = all[i].second;
+		/* Lookup where this falls in offset */
+		xy = std::make_pair(x % ow, y % oh);
+		if (++hits[xy.first][xy.second] > mode) {
+			mode = hits[xy.first][xy.second];
+			loc = xy;
 		}
+		/* Use this offset to hash */
+		Offset o = offset.GetPixel(xy.first, xy.second);
+		xy = std::make_pair((x + o.dx) % s_hash, (y + o.dy) % s_hash);
+		BUCKET *bucket = &hash[xy.first * s_hash + xy.second];
+		/* Mark any collisions */
+		if (!bucket->empty()) ++collisions;
+		bucket->insert(values[i]);
 	}
 	return collisions;
 }
@@ -95,169 +100,847 @@ Reset(BUCKET *&c, BUCKET *d = NULL)
 
 static void
 Fill(
-		const Image<Color> &input,
+		const POINTS &all,
 		const Image<Offset> &offset,
 		const BUCKET *temp_data,
 		Image<Color> &hash_data)
 {
-	int ih, iw, ow, oh, hw, hh;
-	iw = input.Width();
-	ih = input.Height();
+	int x, y, ow, oh, hw, hh;
 	ow = offset.Width();
 	oh = offset.Height();
 	hw = hash_data.Width();
 	hh = hash_data.Height();
 	/* Set the pixels to their final state */
 	std::pair<int, int> xy;
-	for (int x = 0; x < iw; ++x) {
-		for (int y = 0; y < ih; ++y) {
-			Color c = input.GetPixel(x, y);
-			if (!(c == WHITE)) {
-				Offset o = offset.GetPixel(x % ow, y % oh);
-				xy = std::make_pair((x + o.dx) % hw, (y + o.dy) % hh);
-				const BUCKET *bucket = &temp_data[xy.first * hw + xy.second];
-				assert(bucket->size() == 1);
-				//Color c = bucket->empty() ? WHITE : *bucket->begin();
-				hash_data.SetPixel(xy.first, xy.second, *bucket->begin());
+	for (std::size_t i = 0; i < all.size(); ++i) {
+		x = all[i].first;
+		y = all[i].second;
+		Offset o = offset.GetPixel(x % ow, y % oh);
+		xy = std::make_pair((x + o.dx) % hw, (y + o.dy) % hh);
+		const BUCKET *bucket = &temp_data[xy.first * hw + xy.second];
+		assert(bucket->size() == 1);
+		//Color c = bucket->empty() ? WHITE : *bucket->begin();
+		hash_data.SetPixel(xy.first, xy.second, *bucket->begin());
+	}
+}
+
+// ============================================================================
+// ============================================================================
+
+/* Most rounds of the search below cannot succeed; a sample of the occupied
+ * pixels is enough to prove that, because any collision among a subset of
+ * the pixels is also a collision among all of them. */
+static const int SAMPLES = 256;
+static const int CANDIDATES = 4;
+
+/* A round of the search that the sample could not rule out */
+struct Round {
+	int s_hash, s_offset, first;
+};
+typedef std::vector<Round> ROUNDS;
+
+/* If compression grows larger than the source, fail */
+static bool
+Fits(const int size, const int s_hash, const int s_offset)
+{
+	return !(24 * size < 24 * SQ(s_hash) + 8 * SQ(s_offset) + size);
+}
+
+/* Rehash with larger offset, or hash as necessary */
+static void
+Advance(int &s_hash, int &s_offset, const int s_offset_i)
+{
+	++s_offset;
+	if (s_hash < s_offset) {
+		++s_hash;
+		s_offset = s_offset_i;
+	}
+}
+
+/* The offset cell Try() reports as fullest, and its load */
+static XY
+Busiest(const POINTS &all, const int s_offset, int *load = NULL)
+{
+	int mode = 0;
+	XY loc(0, 0), xy;
+	std::vector<int> hits(SQ(s_offset), 0);
+	for (POINTS::const_iterator it = all.begin(); it != all.end(); ++it) {
+		xy = std::make_pair(it->first % s_offset, it->second % s_offset);
+		if (++hits[xy.first * s_offset + xy.second] > mode) {
+			mode = hits[xy.first * s_offset + xy.second];
+			loc = xy;
+		}
+	}
+	if (load) *load = mode;
+	return loc;
+}
+
+/* The offset that attempt n of a round gives to cell (i, j) */
+static Offset
+Pattern(const int n, const int s_offset, const XY &max, const int i, const int j)
+{
+	if (n == 0 || (i == max.first && j == max.second)) return ZERO;
+	return Offset(i % ((n - 1) / s_offset + 1), j % ((n - 1) % s_offset + 1));
+}
+
+/* Whether the sampled pixels hash without collision on attempt n */
+static bool
+Clean(
+		const POINTS &some, const int s_hash, const int s_offset,
+		const int n, const XY &max, std::vector<int> &seen, int &stamp)
+{
+	int x, y;
+	++stamp;
+	for (POINTS::const_iterator it = some.begin(); it != some.end(); ++it) {
+		x = it->first;
+		y = it->second;
+		Offset o = Pattern(n, s_offset, max, x % s_offset, y % s_offset);
+		int slot = ((x + o.dx) % s_hash) * s_hash + (y + o.dy) % s_hash;
+		if (seen[slot] == stamp) return false;
+		seen[slot] = stamp;
+	}
+	return true;
+}
+
+/* Add a pair of pixels that collide on attempt n to the sample, so that the
+ * sample keeps up with the crowded parts of the image; a pixel the sample
+ * already holds is not added twice, or it would collide with itself */
+static void
+Learn(
+		const POINTS &all, POINTS &some, const int s_hash, const int s_offset,
+		const int n, const XY &max, std::vector<int> &seen, int &stamp)
+{
+	int x, y;
+	std::vector<int> owner(seen.size());
+	++stamp;
+	for (std::size_t i = 0; i < all.size(); ++i) {
+		x = all[i].first;
+		y = all[i].second;
+		Offset o = Pattern(n, s_offset, max, x % s_offset, y % s_offset);
+		int slot = ((x + o.dx) % s_hash) * s_hash + (y + o.dy) % s_hash;
+		if (seen[slot] == stamp) {
+			XY pair[2] = { all[owner[slot]], all[i] };
+			for (int j = 0; j < 2; ++j) {
+				if (std::find(some.begin(), some.end(), pair[j]) == some.end()) {
+					some.push_back(pair[j]);
+				}
+			}
+			return;
+		}
+		seen[slot] = stamp;
+		owner[slot] = i;
+	}
+}
+
+/* Walk the search forward from (s_hash, s_offset) until a few rounds turn up
+ * that the sample cannot rule out; returns how many rounds were skipped */
+static int
+Estimate(
+		const POINTS &all, const POINTS &some, const int size,
+		const int s_offset_i, int &s_hash, int &s_offset, ROUNDS &rounds)
+{
+	int skipped = 0, stamp = 0;
+	std::vector<int> seen;
+	rounds.clear();
+	while (Fits(size, s_hash, s_offset)
+			&& rounds.size() < static_cast<std::size_t>(CANDIDATES)) {
+		Round r = { s_hash, s_offset, -1 };
+		if (s_offset > 0) {
+			XY max = Busiest(all, s_offset);
+			seen.resize(SQ(s_hash), 0);
+			for (int n = 0; n < SQ(s_offset) && r.first < 0; ++n) {
+				if (Clean(some, s_hash, s_offset, n, max, seen, stamp)) r.first = n;
 			}
 		}
+		if (r.first < 0) ++skipped; else rounds.push_back(r);
+		Advance(s_hash, s_offset, s_offset_i);
 	}
+	return skipped;
 }
 
+/* Search for a perfect hash of the occupied pixels of a w x h image, given
+ * in the order a column-by-column scan of the image would find them; the
+ * search may resume from the sizes (from_hash, from_offset) of an earlier one */
 static void
 Compress(
-		const Image<Color> &input,
+		const int w, const int h,
+		const POINTS &all, const COLORS &values,
 		Image<bool> &occupancy,
 		Image<Color> &hash_data,
-		Image<Offset> &offset)
+		Image<Offset> &offset,
+		const int from_hash = 0, const int from_offset = 0)
 {
 	/* Calculate p + occupancy */
-	int h, w, p = 0;
-	w = input.Width();
-	h = input.Height();
-	/* Set all occupancy pixels */
+	int p = static_cast<int>(all.size());
+	POINTS some;
 	occupancy.Allocate(w, h);
-	for (int x = 0; x < w; ++x) {
-		for (int y = 0; y < h; ++y) {
-			bool not_white = !(input.GetPixel(x, y) == WHITE);
-			occupancy.SetPixel(x, y, not_white);
-			p += not_white; // FIXME bad?
-		}
+	occupancy.SetAllPixels(false);
+	for (POINTS::const_iterator it = all.begin(); it != all.end(); ++it) {
+		occupancy.SetPixel(it->first, it->second, true);
+	}
+	/* Spread the sample evenly over the occupied pixels */
+	int k = p < SAMPLES ? p : SAMPLES;
+	for (int i = 0; i < k; ++i) {
+		some.push_back(all[static_cast<std::size_t>(i) * p / k]);
 	}
 	/* These are some simple constraints */
 	int s_hash, s_offset, size = w * h;
 	s_hash = static_cast<int>(ceil(sqrt(static_cast<double>(p) * 1.01)));
 	s_offset = static_cast<int>(ceil(sqrt(static_cast<double>(p) / 4.)));
 	int s_offset_i = s_offset, t = 0;
+	if (from_hash > s_hash || (from_hash == s_hash && from_offset > s_offset)) {
+		s_hash = from_hash;
+		s_offset = std::max(from_offset, s_offset_i);
+	}
 	/* These will contain intermediate data */
 	std::pair<int, int> max;
 	BUCKET *colors = NULL;
+	std::vector<int> seen;
+	/* Predict where the search can first succeed, and start there */
+	ROUNDS rounds;
+	int next_hash = s_hash, next_offset = s_offset, misses = 0, stamp = 0;
+	int skipped = Estimate(all, some, size, s_offset_i,
+			next_hash, next_offset, rounds);
+	#ifndef NDEBUG
+	Round guess = rounds.empty()
+		? Round() : rounds.front();
+	if (!rounds.empty()) {
+		int load;
+		Busiest(all, guess.s_offset, &load);
+		double density = static_cast<double>(p) / size;
+		std::cout << "Estimate: (sampled " << k << " of " << p << " pixels)" << std::endl;
+		std::cout << "density:    " << PCT(density)        << std::endl;
+		std::cout << "cell load:  " << FMT(load)           << std::endl;
+		std::cout << "s_hash:     " << FMT(guess.s_hash)   << std::endl;
+		std::cout << "s_offset:   " << FMT(guess.s_offset) << std::endl;
+		std::cout << "skipped:    " << FMT(skipped)        << std::endl;
+	}
+	#endif
 	/* Repeatedly attempt to find a perfect hash-function */
-	while (true) {
-		/* Create a blank offset of the given size */
-		offset.Allocate(s_offset, s_offset);
-		offset.SetAllPixels(ZERO);
-		/* If compression grows larger than the source, fail */
-		if (24 * size < 24 * SQ(s_hash) + 8 * SQ(s_offset) + size) {
+	for (std::size_t r = 0; true; ++r) {
+		if (r == rounds.size()) {
+			skipped += Estimate(all, some, size, s_offset_i,
+					next_hash, next_offset, rounds);
+			r = 0;
+		}
+		if (rounds.empty()) {
 			// FIXME what about limit of offset storage type?
 			std::cerr << "No perfect hash-function exists!" << std::endl;
-			hash_data.Allocate(s_hash, s_hash);
+			offset.Allocate(next_offset, next_offset);
+			offset.SetAllPixels(ZERO);
+			hash_data.Allocate(next_hash, next_hash);
 			hash_data.SetAllPixels(WHITE);
 			#ifndef NDEBUG
 			std::cout << "Attempts made: " << t << std::endl;
+			std::cout << "Rounds skipped: " << skipped << std::endl;
 			#endif
 			Reset(colors); break;
 		}
-		/* Try all offset values to locate a collision-free hash */
-		for (int i = 1; i <= s_offset; ++i) {
-			for (int j = 1; j <= s_offset; ++j) {
-				Reset(colors, new BUCKET[SQ(s_hash)]);
-				/* Attempt to perform a hash using the current offsets */
-				if (Try(input, offset, colors, s_hash, max)) {
-					if (i == 0 && j == 0) continue;
-					for (int oi = 0; oi < s_offset; ++oi) {
-						for (int oj = 0; oj < s_offset; ++oj) {
-							offset.SetPixel(oi, oj, Offset(oi % i, oj % j));
-						}
-					}
-					// TODO use max to just increment the offset positions
-					offset.SetPixel(max.first, max.second, ZERO);
-				} else {
-					hash_data.Allocate(s_hash, s_hash);
-					hash_data.SetAllPixels(WHITE);
-					Fill(input, offset, colors, hash_data);
-					#ifndef NDEBUG
-					// TODO are we really done?
-					int bits_in, bits_mask, bits_hash, bits_offs, bits_out;
-					bits_in   = 8 * sizeof(Color)  * size;
-					bits_mask = 8 * sizeof(bool)   * size;
-					bits_hash = 8 * sizeof(Color)  * SQ(s_hash);
-					bits_offs = 8 * sizeof(Offset) * SQ(s_offset);
-					bits_out  = bits_mask + bits_hash + bits_offs;
-					int bits_opt1 = bits_mask + 8 * sizeof(Color) * p;
-					int bits_opt2 = bits_opt1 + 8 * sizeof(Offset) * SQ(s_offset_i);
-					std::cout << "Space used: (in bits)" << std::endl;
-					std::cout << "input:      " << FMT(bits_in)   << std::endl;
-					std::cout << "w/o blanks: " << FMT(bits_opt1) << std::endl;
-					std::cout << "w/ offset': " << FMT(bits_opt2) << std::endl;
-					std::cout << "occupancy:  " << FMT(bits_mask) << std::endl;
-					std::cout << "hash_data:  " << FMT(bits_hash) << std::endl;
-					std::cout << "offset:     " << FMT(bits_offs) << std::endl;
-					std::cout << "total:      " << FMT(bits_out)  << std::endl;
-					double comp_ratio, best_ratio, real_ratio;
-					comp_ratio = static_cast<double>(bits_out) / bits_in;
-					best_ratio = static_cast<double>(bits_opt1) / bits_in;
-					real_ratio = static_cast<double>(bits_opt2) / bits_in;
-					std::cout << "Compression ratios:" << std::endl;
-					std::cout << "achieved:   " << PCT(comp_ratio) << std::endl;
-					std::cout << "optimal:    " << PCT(best_ratio) << std::endl;
-					std::cout << "realistic:  " << PCT(real_ratio) << std::endl;
-					#endif
-					return;
-				} ++t;
+		s_hash = rounds[r].s_hash;
+		s_offset = rounds[r].s_offset;
+		/* Create an offset of the given size */
+		offset.Allocate(s_offset, s_offset);
+		max = Busiest(all, s_offset);
+		seen.resize(SQ(s_hash), 0);
+		/* Try the offset values the sample does not already rule out */
+		for (int n = rounds[r].first; n < SQ(s_offset); ++n) {
+			if (!Clean(some, s_hash, s_offset, n, max, seen, stamp)) continue;
+			for (int oi = 0; oi < s_offset; ++oi) {
+				for (int oj = 0; oj < s_offset; ++oj) {
+					offset.SetPixel(oi, oj, Pattern(n, s_offset, max, oi, oj));
+				}
 			}
-		}
-		/* Rehash with larger offset, or hash as necessary */
-		++s_offset;
-		if (s_hash < s_offset) {
-			++s_hash;
-			++s_offset = s_offset_i;
+			Reset(colors, new BUCKET[SQ(s_hash)]);
+			/* Attempt to perform a hash using the current offsets */
+			if (Try(all, values, offset, colors, s_hash, max)) {
+				Learn(all, some, s_hash, s_offset, n, max, seen, stamp);
+				++misses;
+			} else {
+				hash_data.Allocate(s_hash, s_hash);
+				hash_data.SetAllPixels(WHITE);
+				Fill(all, offset, colors, hash_data);
+				Reset(colors);
+				#ifndef NDEBUG
+				// TODO are we really done?
+				int bits_in, bits_mask, bits_hash, bits_offs, bits_out;
+				bits_in   = 8 * sizeof(Color)  * size;
+				bits_mask = 8 * sizeof(bool)   * size;
+				bits_hash = 8 * sizeof(Color)  * SQ(s_hash);
+				bits_offs = 8 * sizeof(Offset) * SQ(s_offset);
+				bits_out  = bits_mask + bits_hash + bits_offs;
+				int bits_opt1 = bits_mask + 8 * sizeof(Color) * p;
+				int bits_opt2 = bits_opt1 + 8 * sizeof(Offset) * SQ(s_offset_i);
+				std::cout << "Space used: (in bits)" << std::endl;
+				std::cout << "input:      " << FMT(bits_in)   << std::endl;
+				std::cout << "w/o blanks: " << FMT(bits_opt1) << std::endl;
+				std::cout << "w/ offset': " << FMT(bits_opt2) << std::endl;
+				std::cout << "occupancy:  " << FMT(bits_mask) << std::endl;
+				std::cout << "hash_data:  " << FMT(bits_hash) << std::endl;
+				std::cout << "offset:     " << FMT(bits_offs) << std::endl;
+				std::cout << "total:      " << FMT(bits_out)  << std::endl;
+				double comp_ratio, best_ratio, real_ratio;
+				comp_ratio = static_cast<double>(bits_out) / bits_in;
+				best_ratio = static_cast<double>(bits_opt1) / bits_in;
+				real_ratio = static_cast<double>(bits_opt2) / bits_in;
+				std::cout << "Compression ratios:" << std::endl;
+				std::cout << "achieved:   " << PCT(comp_ratio) << std::endl;
+				std::cout << "optimal:    " << PCT(best_ratio) << std::endl;
+				std::cout << "realistic:  " << PCT(real_ratio) << std::endl;
+				double hit_ratio = 1. / (misses + 1);
+				std::cout << "Search: (estimate vs. found)" << std::endl;
+				std::cout << "s_hash:     " << FMT(guess.s_hash)   << std::endl;
+				std::cout << "            " << FMT(s_hash)         << std::endl;
+				std::cout << "s_offset:   " << FMT(guess.s_offset) << std::endl;
+				std::cout << "            " << FMT(s_offset)       << std::endl;
+				std::cout << "skipped:    " << FMT(skipped)        << std::endl;
+				std::cout << "attempts:   " << FMT(t + 1)          << std::endl;
+				std::cout << "hit rate:   " << PCT(hit_ratio)      << std::endl;
+				#endif
+				return;
+			} ++t;
 		}
 	}
 }
 
 static void
-UnCompress(
+Compress(
+		const Image<Color> &input,
+		Image<bool> &occupancy,
+		Image<Color> &hash_data,
+		Image<Offset> &offset,
+		const int from_hash = 0, const int from_offset = 0)
+{
+	/* Gather the non-white pixels */
+	POINTS all;
+	COLORS values;
+	for (int x = 0; x < input.Width(); ++x) {
+		for (int y = 0; y < input.Height(); ++y) {
+			Color c = input.GetPixel(x, y);
+			if (!(c == WHITE)) {
+				all.push_back(std::make_pair(x, y));
+				values.push_back(c);
+			}
+		}
+	}
+	Compress(input.Width(), input.Height(), all, values,
+			occupancy, hash_data, offset, from_hash, from_offset);
+}
+
+/* Whether a filename holds a point list instead of a dense image */
+static bool
+Listed(const std::string &filename)
+{
+	std::string name = CodedFile::Plain(filename);
+	int len = name.length();
+	return len > 4 && (name.substr(len - 4) == std::string(".pts")
+			|| name.substr(len - 4) == std::string(".txt"));
+}
+
+/* Order points the way a column-by-column scan meets them */
+static bool
+ByPosition(const Point &a, const Point &b)
+{
+	return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+/* Compress a point list without ever building the dense image; white
+ * points are blank anyway, and of repeated points the last one counts */
+static bool
+Compress(
+		const PointList &input,
+		Image<bool> &occupancy,
+		Image<Color> &hash_data,
+		Image<Offset> &offset)
+{
+	int w = input.width, h = input.height;
+	std::vector<Point> sorted(input.points);
+	std::stable_sort(sorted.begin(), sorted.end(), ByPosition);
+	POINTS all;
+	COLORS values;
+	for (std::size_t i = 0; i < sorted.size(); ++i) {
+		const Point &pt = sorted[i];
+		if (pt.x < 0 || pt.x >= w || pt.y < 0 || pt.y >= h) {
+			std::cerr << "Error: point (" << pt.x << ", " << pt.y
+				<< ") lies outside " << w << "x" << h << std::endl;
+			return false;
+		}
+		if (i + 1 < sorted.size() && !ByPosition(pt, sorted[i + 1])) continue;
+		if (pt.color == WHITE) continue;
+		all.push_back(std::make_pair(pt.x, pt.y));
+		values.push_back(pt.color);
+	}
+	Compress(w, h, all, values, occupancy, hash_data, offset);
+	return true;
+}
+
+// ============================================================================
+// ============================================================================
+
+/* Whether a filename asks for check tags in place of occupancy */
+static bool
+Checked(const std::string &filename)
+{
+	std::string name = CodedFile::Plain(filename);
+	int len = name.length();
+	return len > 6 && name.substr(len - 6) == std::string(".check");
+}
+
+/* Tag each hash slot with the pixel that owns it; returns how many blank
+ * pixels decode as occupied anyway (about 1 in (2^bits - 1) of those
+ * that land on a full slot) */
+static int
+Encode(
 		const Image<bool> &occupancy,
 		const Image<Color> &hash_data,
 		const Image<Offset> &offset,
-		Image<Color> &output)
+		const int bits,
+		CheckTable &checks)
 {
 	/* Fetch useful values */
-	int h, w, hh, hw, oh, ow;
+	int h, w, hh, hw, oh, ow, false_pos = 0;
 	w = occupancy.Width();
 	h = occupancy.Height();
 	hw = hash_data.Width();
 	hh = hash_data.Height();
 	ow = offset.Width();
 	oh = offset.Height();
-	/* Set output pixels */
-	output.Allocate(w, h);
-	output.SetAllPixels(WHITE);
+	/* Set the tags of occupied slots */
+	checks.width = w;
+	checks.height = h;
+	checks.bits = bits;
+	checks.tags.Allocate(hw, hh);
+	checks.tags.SetAllPixels(0);
 	for (int x = 0; x < w; ++x) {
 		for (int y = 0; y < h; ++y) {
 			if (occupancy.GetPixel(x, y)) {
 				Offset o = offset.GetPixel(x % ow, y % oh);
-				Color c = hash_data.GetPixel((x + o.dx) % hw, (y + o.dy) % hh);
-				output.SetPixel(x, y, c);
+				checks.tags.SetPixel((x + o.dx) % hw, (y + o.dy) % hh, Tag(x, y, bits));
+			}
+		}
+	}
+	/* Count the blank pixels that carry a matching tag */
+	for (int x = 0; x < w; ++x) {
+		for (int y = 0; y < h; ++y) {
+			if (!occupancy.GetPixel(x, y)) {
+				Offset o = offset.GetPixel(x % ow, y % oh);
+				unsigned char t = checks.tags.GetPixel((x + o.dx) % hw, (y + o.dy) % hh);
+				false_pos += (t == Tag(x, y, bits));
+			}
+		}
+	}
+	return false_pos;
+}
+
+// ============================================================================
+// ============================================================================
+
+/* What one frame of a sequence hands on to the next */
+struct Warm {
+	Warm() : valid(false) { }
+	bool valid;
+	Image<bool> occupancy;
+	Image<Color> hash_data;
+	Image<Offset> offset;
+	/* The pixel (y * w + x) that owns each hash slot, or -1 */
+	Image<int> owner;
+};
+
+/* Record which pixel owns each slot of a freshly compressed frame */
+static void
+Adopt(Warm &warm)
+{
+	int h, w, hh, hw, oh, ow, hx, hy;
+	w = warm.occupancy.Width();
+	h = warm.occupancy.Height();
+	hw = warm.hash_data.Width();
+	hh = warm.hash_data.Height();
+	ow = warm.offset.Width();
+	oh = warm.offset.Height();
+	warm.valid = (hw > 0 && ow > 0);
+	if (!warm.valid) return;
+	warm.owner.Allocate(hw, hh);
+	warm.owner.SetAllPixels(-1);
+	for (int x = 0; x < w; ++x) {
+		for (int y = 0; y < h; ++y) {
+			if (warm.occupancy.GetPixel(x, y)) {
+				Offset o = warm.offset.GetPixel(x % ow, y % oh);
+				hx = (x + o.dx) % hw;
+				hy = (y + o.dy) % hh;
+				/* No perfect hash was found, so there is nothing to keep */
+				if (warm.owner.GetPixel(hx, hy) != -1) {
+					warm.valid = false;
+					return;
+				}
+				warm.owner.SetPixel(hx, hy, y * w + x);
+			}
+		}
+	}
+}
+
+/* Release the slots held by the pixels of offset cell (cx, cy) */
+static void
+Evict(Warm &warm, const int cx, const int cy)
+{
+	int h, w, hh, hw, oh, ow, hx, hy;
+	w = warm.occupancy.Width();
+	h = warm.occupancy.Height();
+	hw = warm.hash_data.Width();
+	hh = warm.hash_data.Height();
+	ow = warm.offset.Width();
+	oh = warm.offset.Height();
+	Offset o = warm.offset.GetPixel(cx, cy);
+	for (int x = cx; x < w; x += ow) {
+		for (int y = cy; y < h; y += oh) {
+			hx = (x + o.dx) % hw;
+			hy = (y + o.dy) % hh;
+			if (warm.owner.GetPixel(hx, hy) == y * w + x) {
+				warm.owner.SetPixel(hx, hy, -1);
+				warm.hash_data.SetPixel(hx, hy, WHITE);
+			}
+		}
+	}
+}
+
+/* Find an offset that puts every pixel of cell (cx, cy) in a free slot */
+static bool
+Place(const Image<Color> &input, Warm &warm, const int cx, const int cy)
+{
+	int h, w, hh, hw, oh, ow, hx, hy;
+	w = warm.occupancy.Width();
+	h = warm.occupancy.Height();
+	hw = warm.hash_data.Width();
+	hh = warm.hash_data.Height();
+	ow = warm.offset.Width();
+	oh = warm.offset.Height();
+	POINTS pixels;
+	for (int x = cx; x < w; x += ow) {
+		for (int y = cy; y < h; y += oh) {
+			if (warm.occupancy.GetPixel(x, y)) pixels.push_back(std::make_pair(x, y));
+		}
+	}
+	/* The .offset format keeps 4 bits per component */
+	for (int dx = 0; dx < 16 && dx < hw; ++dx) {
+		for (int dy = 0; dy < 16 && dy < hh; ++dy) {
+			std::size_t n = 0;
+			for (; n < pixels.size(); ++n) {
+				hx = (pixels[n].first + dx) % hw;
+				hy = (pixels[n].second + dy) % hh;
+				if (warm.owner.GetPixel(hx, hy) != -1) break;
+				warm.owner.SetPixel(hx, hy, pixels[n].second * w + pixels[n].first);
+			}
+			if (n == pixels.size()) {
+				warm.offset.SetPixel(cx, cy, Offset(dx, dy));
+				for (n = 0; n < pixels.size(); ++n) {
+					hx = (pixels[n].first + dx) % hw;
+					hy = (pixels[n].second + dy) % hh;
+					warm.hash_data.SetPixel(hx, hy,
+							input.GetPixel(pixels[n].first, pixels[n].second));
+				}
+				return true;
+			}
+			/* Give back the slots claimed along the way */
+			while (n--) {
+				hx = (pixels[n].first + dx) % hw;
+				hy = (pixels[n].second + dy) % hh;
+				warm.owner.SetPixel(hx, hy, -1);
+			}
+		}
+	}
+	return false;
+}
+
+/* Compress the next frame of a sequence by repairing the previous frame's
+ * hash only where occupancy changed; returns how many offset cells needed
+ * a new offset, or -1 when the previous hash cannot be kept */
+static int
+Repair(const Image<Color> &input, Warm &warm)
+{
+	int h, w, hh, hw, oh, ow, hx, hy;
+	w = input.Width();
+	h = input.Height();
+	if (!warm.valid) return -1;
+	if (w != warm.occupancy.Width() || h != warm.occupancy.Height()) return -1;
+	hw = warm.hash_data.Width();
+	hh = warm.hash_data.Height();
+	ow = warm.offset.Width();
+	oh = warm.offset.Height();
+	/* Carry over the pixels that stay, free the ones that left */
+	POINTS added, cells;
+	for (int x = 0; x < w; ++x) {
+		for (int y = 0; y < h; ++y) {
+			Color c = input.GetPixel(x, y);
+			bool now = !(c == WHITE), was = warm.occupancy.GetPixel(x, y);
+			if (!now && !was) continue;
+			Offset o = warm.offset.GetPixel(x % ow, y % oh);
+			hx = (x + o.dx) % hw;
+			hy = (y + o.dy) % hh;
+			if (now && was) {
+				warm.hash_data.SetPixel(hx, hy, c);
+			} else if (was) {
+				warm.owner.SetPixel(hx, hy, -1);
+				warm.hash_data.SetPixel(hx, hy, WHITE);
+			} else {
+				added.push_back(std::make_pair(x, y));
 			}
+			warm.occupancy.SetPixel(x, y, now);
+		}
+	}
+	/* New pixels take their slot if it is free, else their cell moves */
+	Image<bool> dirty;
+	dirty.Allocate(ow, oh);
+	dirty.SetAllPixels(false);
+	for (POINTS::const_iterator it = added.begin(); it != added.end(); ++it) {
+		int x = it->first, y = it->second;
+		Offset o = warm.offset.GetPixel(x % ow, y % oh);
+		hx = (x + o.dx) % hw;
+		hy = (y + o.dy) % hh;
+		if (warm.owner.GetPixel(hx, hy) == -1) {
+			warm.owner.SetPixel(hx, hy, y * w + x);
+			warm.hash_data.SetPixel(hx, hy, input.GetPixel(x, y));
+		} else if (!dirty.GetPixel(x % ow, y % oh)) {
+			dirty.SetPixel(x % ow, y % oh, true);
+			cells.push_back(std::make_pair(x % ow, y % oh));
+		}
+	}
+	for (POINTS::const_iterator it = cells.begin(); it != cells.end(); ++it) {
+		Evict(warm, it->first, it->second);
+	}
+	for (POINTS::const_iterator it = cells.begin(); it != cells.end(); ++it) {
+		if (!Place(input, warm, it->first, it->second)) {
+			warm.valid = false;
+			return -1;
+		}
+	}
+	return static_cast<int>(cells.size());
+}
+
+/* Compress frames one after another, each starting from the last one's hash;
+ * writes <prefix>_NNNN.{pbm,ppm,offset} and lists them in <prefix>.seq */
+static void
+CompressSequence(
+		const std::string &prefix,
+		char *inputs[], const int count,
+		const bool shared)
+{
+	Warm warm;
+	std::string offset_name;
+	std::ofstream seq((prefix + ".seq").c_str());
+	for (int i = 0; i < count; ++i) {
+		char tmp[16];
+		sprintf(tmp, "_%04d", i);
+		std::string name = prefix + tmp;
+		Image<Color> input;
+		input.Load(inputs[i]);
+		std::clock_t start = std::clock();
+		/* A frame the last hash cannot take resumes the search at its sizes */
+		int from_hash = 0, from_offset = 0;
+		if (warm.valid && input.Width() == warm.occupancy.Width()
+				&& input.Height() == warm.occupancy.Height()) {
+			from_hash = warm.hash_data.Width();
+			from_offset = warm.offset.Width();
+		}
+		int cells = Repair(input, warm);
+		if (cells < 0) {
+			Compress(input, warm.occupancy, warm.hash_data, warm.offset,
+					from_hash, from_offset);
+			Adopt(warm);
 		}
+		double ms = 1000. * (std::clock() - start) / CLOCKS_PER_SEC;
+		warm.occupancy.Save(name + ".pbm");
+		warm.hash_data.Save(name + ".ppm");
+		/* Keep pointing at the last offset table while it is unchanged */
+		if (!shared || cells != 0) {
+			offset_name = name + ".offset";
+			warm.offset.Save(offset_name);
+		}
+		seq << name << ".pbm " << name << ".ppm " << offset_name << std::endl;
+		#ifndef NDEBUG
+		std::cout << "Frame " << i << ": ";
+		if (cells < 0) {
+			std::cout << "searched from scratch";
+		} else {
+			std::cout << "repaired " << cells << " offset cell(s)";
+		}
+		std::cout << " in " << std::fixed << std::setprecision(3)
+			<< ms << " ms" << std::endl;
+		#else
+		(void) ms;
+		#endif
 	}
 }
 
 // ============================================================================
 // ============================================================================
 
+/* Rows per band passed along a pipeline, bands let in flight per stage, and
+ * threads for the I/O (each stage may block, so one thread per stage) */
+static const int BAND_ROWS = 32;
+static const int BANDS = 8;
+static const int IO_THREADS = 4;
+
+/* A band of rows on its way through the uncompress pipeline */
+struct Band {
+	int y0;   // image row of the band's bottom row
+	int rows;
+	std::vector<unsigned char> pixels; // RGB24, top row first
+};
+typedef Queue<Band *> BANDS_Q;
+
+/* Load one input, then report whether that worked */
+template <class T>
+class LoadTask : public Task {
+public:
+	LoadTask(T &i, const std::string &f, Queue<bool> &d) :
+		image(i), filename(f), done(d) { }
+	void Run() { done.Push(image.Load(filename)); }
+private:
+	T &image;
+	std::string filename;
+	Queue<bool> &done;
+};
+
+/* Save one output */
+template <class T>
+class SaveTask : public Task {
+public:
+	SaveTask(const T &i, const std::string &f) : image(i), filename(f) { }
+	void Run() { image.Save(filename); }
+private:
+	const T &image;
+	std::string filename;
+};
+
+/* Read occupancy a band at a time, announcing each band once it is in */
+class ReadTask : public Task {
+public:
+	ReadTask(RowReader<bool> &r, Image<bool> &o, BANDS_Q &b) :
+		reader(r), occupancy(o), bands(b) { }
+	void Run() {
+		int w = reader.Width(), h = reader.Height();
+		bool *pixels = new bool[w + 1];
+		for (int first = 0; first < h; first += BAND_ROWS) {
+			Band *band = new Band();
+			band->rows = std::min(BAND_ROWS, h - first);
+			band->y0 = h - first - band->rows;
+			/* flip y so that (0,0) is bottom left corner */
+			for (int r = 0; r < band->rows; ++r) {
+				bool ok = reader.Read(pixels);
+				for (int x = 0; x < w; ++x) {
+					occupancy.SetPixel(x, h - 1 - first - r, ok && pixels[x]);
+				}
+			}
+			bands.Push(band);
+		}
+		delete [] pixels;
+	}
+private:
+	RowReader<bool> &reader;
+	Image<bool> &occupancy;
+	BANDS_Q &bands;
+};
+
+/* Write decoded bands out in order, as they arrive */
+class WriteTask : public Task {
+public:
+	WriteTask(RowWriter<Color> &w, BANDS_Q &b) : writer(w), bands(b), ok(true) { }
+	void Run() {
+		Band *band;
+		while (bands.Pop(band)) {
+			std::size_t pitch = band->pixels.size() / band->rows;
+			for (int r = 0; r < band->rows && ok; ++r) {
+				ok = writer.Write(&band->pixels[r * pitch]);
+			}
+			delete band;
+		}
+	}
+	/* Whether every row was written; read once the task is joined */
+	bool Ok() const { return ok; }
+private:
+	RowWriter<Color> &writer;
+	BANDS_Q &bands;
+	bool ok;
+};
+
+/* The uncompress command as a pipeline: the inputs load side by side,
+ * bands decode as soon as their occupancy is in, and decoded bands are
+ * written out while later ones are still decoding */
+static bool
+UnCompressFiles(
+		const std::string &mask,
+		const std::string &data,
+		const std::string &offs,
+		const std::string &out)
+{
+	bool checked = Checked(mask), ok = true, loaded = false;
+	int w, h, loads = 2;
+	Image<Color> hash_data;
+	Image<Offset> offset;
+	Image<bool> occupancy;
+	CheckTable checks;
+	RowReader<bool> reader;
+	RowWriter<Color> writer;
+	Queue<bool> done(3);
+	BANDS_Q decode(BANDS), encode(BANDS);
+	LoadTask<Image<Color> > load_data(hash_data, data, done);
+	LoadTask<Image<Offset> > load_offs(offset, offs, done);
+	LoadTask<CheckTable> load_mask(checks, mask, done);
+	ReadTask read(reader, occupancy, decode);
+	WriteTask write(writer, encode);
+	/* Occupancy streams in; check tags are needed whole */
+	if (!checked && !reader.Open(mask)) return false;
+	if (!checked) occupancy.Allocate(reader.Width(), reader.Height());
+	Pool pool(IO_THREADS);
+	pool.Start(&load_data);
+	pool.Start(&load_offs);
+	if (checked) {
+		pool.Start(&load_mask);
+		++loads;
+	} else {
+		pool.Start(&read);
+	}
+	/* Decoding needs all of the hash and offset tables */
+	while (loads--) {
+		ok = done.Pop(loaded) && loaded && ok;
+	}
+	w = checked ? checks.width : reader.Width();
+	h = checked ? checks.height : reader.Height();
+	ok = ok && writer.Open(out, w, h);
+	pool.Start(&write);
+	/* Decode each band straight into the bytes the writer will use */
+	for (int first = 0; first < h; first += BAND_ROWS) {
+		Band *band;
+		if (checked) {
+			band = new Band();
+			band->rows = std::min(BAND_ROWS, h - first);
+			band->y0 = h - first - band->rows;
+		} else {
+			decode.Pop(band);
+		}
+		if (ok && w > 0) {
+			band->pixels.resize(3 * w * band->rows);
+			Framebuffer fb(&band->pixels[0], 3 * w, RGB24);
+			if (checked) {
+				UnCompress(checks, hash_data, offset, fb, 0, band->y0, w, band->rows);
+			} else {
+				UnCompress(occupancy, hash_data, offset, fb, 0, band->y0, w, band->rows);
+			}
+			encode.Push(band);
+		} else {
+			delete band;
+		}
+	}
+	encode.Close();
+	pool.Join();
+	if (!write.Ok() || !writer.Close()) {
+		std::cerr << "Unable to write " << out << std::endl;
+		return false;
+	}
+	return ok;
+}
+
+// ============================================================================
+// ============================================================================
+
 static void
 Compare(
 		const Image<Color> &input1,
@@ -325,15 +1008,106 @@ ConvertOffsetToColor(const Image<Offset> &input, Image<Color> &output)
 // ============================================================================
 // ============================================================================
 
+/* Wall-clock seconds, since decoding runs on several threads */
+static double
+Now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Encoding speed for a given chunk size, in MB/s */
+static double
+Throughput(const std::vector<unsigned char> &bytes, const std::size_t chunk)
+{
+	int runs = 0;
+	double start = Now(), elapsed;
+	/* Repeat until the timing means something */
+	do {
+		Chunked coded;
+		coded.Encode(&bytes[0], bytes.size(), chunk);
+		++runs;
+		elapsed = Now() - start;
+	} while (elapsed < 0.05);
+	return runs * static_cast<double>(bytes.size()) / elapsed / 1e6;
+}
+
+/* Decoding speed of a coded stream, in MB/s */
+static double
+Throughput(const Chunked &coded, const int threads)
+{
+	std::vector<unsigned char> out;
+	int runs = 0;
+	double start = Now(), elapsed;
+	/* Repeat until the timing means something */
+	do {
+		coded.Decode(out, threads);
+		++runs;
+		elapsed = Now() - start;
+	} while (elapsed < 0.05);
+	return runs * static_cast<double>(coded.Size()) / elapsed / 1e6;
+}
+
+/* Show how small a file gets as a .rans file, and what that costs to
+ * encode and decode, for a few chunk sizes (smaller chunks give finer
+ * random access) */
+static bool
+ReportEntropy(const std::string &filename)
+{
+	CodedFile in;
+	FILE *file = in.Open(filename, "rb");
+	if (file == NULL) {
+		std::cerr << "Unable to open " << filename << " for reading\n";
+		return false;
+	}
+	std::vector<unsigned char> bytes;
+	for (int c = fgetc(file); c != EOF; c = fgetc(file)) {
+		bytes.push_back(static_cast<unsigned char>(c));
+	}
+	in.Close();
+	if (bytes.empty()) {
+		std::cerr << "Nothing to code in " << filename << std::endl;
+		return false;
+	}
+	std::cout << filename << ": " << bytes.size() << " bytes" << std::endl;
+	std::cout << std::setw(10) << "chunk" << std::setw(12) << "on disk"
+		<< std::setw(10) << "ratio" << std::setw(14) << "encode"
+		<< std::setw(14) << "1 thread"
+		<< std::setw(10) << IO_THREADS << " threads" << std::endl;
+	for (std::size_t chunk = 1 << 12; chunk <= (1 << 18); chunk <<= 2) {
+		Chunked coded;
+		coded.Encode(&bytes[0], bytes.size(), chunk);
+		double ratio = static_cast<double>(coded.FileSize()) / bytes.size();
+		std::cout << std::setw(10) << chunk
+			<< std::setw(12) << coded.FileSize()
+			<< std::setw(9) << std::fixed << std::setprecision(2) << ratio * 100. << "%"
+			<< std::setw(9) << std::setprecision(1) << Throughput(bytes, chunk) << " MB/s"
+			<< std::setw(9) << Throughput(coded, 1) << " MB/s"
+			<< std::setw(13) << Throughput(coded, IO_THREADS) << " MB/s" << std::endl;
+	}
+	return true;
+}
+
+// ============================================================================
+// ============================================================================
+
 static void
 usage(char *argv)
 {
 	using std::cerr;
-	cerr << "Four usage options:" << std::endl;
+	cerr << "Six usage options:" << std::endl;
 	cerr << " 1) " << argv << " compress input.ppm occupancy.pbm data.ppm offset.offset\n";
+	cerr << "    " << argv << " compress points.{pts,txt} occupancy.pbm data.ppm offset.offset\n";
+	cerr << "    " << argv << " compress input.ppm checks.check data.ppm offset.offset [bits]\n";
+	cerr << "    (bits per check tag, 2 to 8, default 8)\n";
 	cerr << " 2) " << argv << " uncompress occupancy.pbm data.ppm offset.offset output.ppm\n";
+	cerr << "    " << argv << " uncompress checks.check data.ppm offset.offset output.ppm\n";
 	cerr << " 3) " << argv << " compare input1.ppm input2.ppm output.pbm\n";
 	cerr << " 4) " << argv << " visualize_offset input.offset output.ppm\n";
+	cerr << " 5) " << argv << " compress_seq [-shared] prefix input1.ppm [input2.ppm ...]\n";
+	cerr << " 6) " << argv << " entropy_report file\n";
+	cerr << "Any file may be kept entropy coded by adding .rans to its name.\n";
 }
 
 // ============================================================================
@@ -348,33 +1122,60 @@ main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 	if (argv[1] == std::string("compress")) {
-		if (argc != 6) { usage(argv[0]); exit(1); }
-		// the original image:
+		bool checked = Checked(argv[3]);
+		if (argc != 6 && !(argc == 7 && checked)) { usage(argv[0]); exit(1); }
+		// bits per check tag, when those replace occupancy
+		int bits = (argc == 7) ? atoi(argv[6]) : 8;
+		if (bits < 2 || bits > 8) { usage(argv[0]); exit(1); }
+		// the original image, or just its non-white points:
 		Image<Color> input;
+		PointList points;
 		// 3 files form the compressed representation:
 		Image<bool> occupancy;
 		Image<Color> hash_data;
 		Image<Offset> offset;
-		input.Load(argv[2]);
-		Compress(input,occupancy,hash_data,offset);
-		// save the compressed representation
-		occupancy.Save(argv[3]);
-		hash_data.Save(argv[4]);
-		offset.Save(argv[5]);
+		if (Listed(argv[2])) {
+			if (!points.Load(argv[2])) return EXIT_FAILURE;
+			if (!Compress(points,occupancy,hash_data,offset)) return EXIT_FAILURE;
+		} else {
+			input.Load(argv[2]);
+			Compress(input,occupancy,hash_data,offset);
+		}
+		// save the compressed representation, all 3 files side by side
+		Pool pool(IO_THREADS);
+		CheckTable checks;
+		SaveTask<Image<bool> > save_mask(occupancy,argv[3]);
+		SaveTask<CheckTable> save_checks(checks,argv[3]);
+		SaveTask<Image<Color> > save_data(hash_data,argv[4]);
+		SaveTask<Image<Offset> > save_offs(offset,argv[5]);
+		pool.Start(&save_data);
+		pool.Start(&save_offs);
+		if (checked) {
+			int false_pos = Encode(occupancy,hash_data,offset,bits,checks);
+			#ifndef NDEBUG
+			int bits_mask = occupancy.Width() * occupancy.Height();
+			int bits_tags = bits * hash_data.Width() * hash_data.Height();
+			std::cout << "Check tags: (in bits)" << std::endl;
+			std::cout << "occupancy:  " << FMT(bits_mask) << std::endl;
+			std::cout << "checks:     " << FMT(bits_tags) << std::endl;
+			std::cout << "false pos.: " << FMT(false_pos) << std::endl;
+			#endif
+			// check tags are lossy, so say when they changed the image
+			if (false_pos > 0) {
+				std::cerr << "Warning: " << false_pos
+					<< " blank pixel(s) will decode as occupied" << std::endl;
+			}
+			pool.Start(&save_checks);
+		} else {
+			pool.Start(&save_mask);
+		}
+		pool.Join();
 	} else if (argv[1] == std::string("uncompress")) {
 		if (argc != 6) { usage(argv[0]); exit(1); }
-		// the compressed representation:
-		Image<bool> occupancy;
-		Image<Color> hash_data;
-		Image<Offset> offset;
-		occupancy.Load(argv[2]);
-		hash_data.Load(argv[3]);
-		offset.Load(argv[4]);
-		// the reconstructed image
-		Image<Color> output;
-		UnCompress(occupancy,hash_data,offset,output);
-		// save the reconstruction
-		output.Save(argv[5]);
+		// the compressed representation, streamed into the reconstruction
+		if (!UnCompressFiles(argv[2],argv[3],argv[4],argv[5])) {
+			return EXIT_FAILURE;
+		}
 	} else if (argv[1] == std::string("compare")) {
 		if (argc != 5) { usage(argv[0]); exit(1); }
 		// the original images
@@ -387,6 +1188,13 @@ main(int argc, char *argv[])
 		Compare(input1,input2,output);
 		// save the difference
 		output.Save(argv[4]);
+	} else if (argv[1] == std::string("compress_seq")) {
+		// -shared stores an unchanged offset table only once
+		bool shared = (argc > 2 && argv[2] == std::string("-shared"));
+		int first = shared ? 4 : 3;
+		if (argc < first + 1) { usage(argv[0]); exit(1); }
+		// each frame is saved as the compress command would
+		CompressSequence(argv[first - 1],argv + first,argc - first,shared);
 	} else if (argv[1] == std::string("visualize_offset")) {
 		if (argc != 4) { usage(argv[0]); exit(1); }
 		// the 8-bit offset image (custom format)
@@ -396,6 +1204,10 @@ main(int argc, char *argv[])
 		Image<Color> output;
 		ConvertOffsetToColor(input,output);
 		output.Save(argv[3]);
+	} else if (argv[1] == std::string("entropy_report")) {
+		if (argc != 3) { usage(argv[0]); exit(1); }
+		// the on-disk size vs. decode speed trade-off of .rans files
+		if (!ReportEntropy(argv[2])) return EXIT_FAILURE;
 	} else {
 		usage(argv[0]);
 		return EXIT_FAILURE;
@@ -0,0 +1,38 @@
+#include "pipeline.h"
+
+// ====================================================================
+// Pool
+// ====================================================================
+Pool::Pool(int threads) : tasks(threads > 0 ? threads : 1) {
+  assert(threads > 0);
+  workers.resize(threads);
+  for (int i = 0; i < threads; ++i) {
+    pthread_create(&workers[i], NULL, &Pool::Work, this);
+  }
+}
+
+Pool::~Pool() {
+  Join();
+}
+
+void Pool::Start(Task *task) {
+  assert(!workers.empty());
+  tasks.Push(task);
+}
+
+void Pool::Join() {
+  tasks.Close();
+  for (std::size_t i = 0; i < workers.size(); ++i) {
+    pthread_join(workers[i], NULL);
+  }
+  workers.clear();
+}
+
+void *Pool::Work(void *pool) {
+  Task *task;
+  // keep taking tasks until the pool is joined
+  while (static_cast<Pool *>(pool)->tasks.Pop(task)) {
+    task->Run();
+  }
+  return NULL;
+}
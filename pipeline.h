@@ -0,0 +1,114 @@
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include <cassert>
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <pthread.h>
+
+// ====================================================================
+// ====================================================================
+// BOUNDED QUEUE
+//    Push blocks while the queue is full, Pop blocks while it is empty;
+//    once closed, Pop drains what is left and then returns false
+//
+
+template <class T>
+class Queue {
+public:
+  explicit Queue(std::size_t l) : limit(l), closed(false) {
+    assert(limit > 0);
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&not_empty, NULL);
+    pthread_cond_init(&not_full, NULL);
+  }
+  ~Queue() {
+    pthread_cond_destroy(&not_full);
+    pthread_cond_destroy(&not_empty);
+    pthread_mutex_destroy(&lock);
+  }
+
+  void Push(const T &item) {
+    pthread_mutex_lock(&lock);
+    while (items.size() >= limit && !closed)
+      pthread_cond_wait(&not_full, &lock);
+    assert(!closed);
+    items.push_back(item);
+    pthread_cond_signal(&not_empty);
+    pthread_mutex_unlock(&lock);
+  }
+  bool Pop(T &item) {
+    pthread_mutex_lock(&lock);
+    while (items.empty() && !closed)
+      pthread_cond_wait(&not_empty, &lock);
+    bool ok = !items.empty();
+    if (ok) {
+      item = items.front();
+      items.pop_front();
+      pthread_cond_signal(&not_full);
+    }
+    pthread_mutex_unlock(&lock);
+    return ok;
+  }
+  void Close() {
+    pthread_mutex_lock(&lock);
+    closed = true;
+    pthread_cond_broadcast(&not_empty);
+    pthread_cond_broadcast(&not_full);
+    pthread_mutex_unlock(&lock);
+  }
+
+private:
+  // not copyable
+  Queue(const Queue &);
+  const Queue& operator=(const Queue &);
+
+  // ==============
+  // REPRESENTATION
+  std::size_t limit;
+  bool closed;
+  std::deque<T> items;
+  pthread_mutex_t lock;
+  pthread_cond_t not_empty, not_full;
+};
+
+
+// ====================================================================
+// ====================================================================
+// THREAD POOL
+//    runs Tasks on a few threads, in the order they were started;
+//    a task that waits on another needs a thread of its own, so size
+//    the pool to the number of tasks that may block at once
+//
+
+class Task {
+public:
+  virtual ~Task() {}
+  virtual void Run() = 0;
+};
+
+class Pool {
+public:
+  explicit Pool(int threads);
+  ~Pool();
+
+  // hand a task to the pool (the caller keeps ownership)
+  void Start(Task *task);
+  // wait for every task started so far, then stop the threads
+  void Join();
+
+private:
+  // not copyable
+  Pool(const Pool &);
+  const Pool& operator=(const Pool &);
+
+  static void *Work(void *pool);
+
+  // ==============
+  // REPRESENTATION
+  Queue<Task *> tasks;
+  std::vector<pthread_t> workers;
+};
+
+#endif